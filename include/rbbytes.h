@@ -0,0 +1,202 @@
+/**
+ * @file rbbytes.h
+ * @author masscry
+ *
+ * Byte ring buffer.
+ *
+ * Stores raw bytes or length-prefixed records inline, so buffering
+ * network data or log messages needs no allocation per message. Writer
+ * reserves space, fills it in place and commits, reader peeks at
+ * contiguous data and consumes it.
+ *
+ * Ring is either byte stream or sequence of records, functions of two
+ * kinds must not be mixed on one ring. Records never wrap storage end,
+ * so every record is contiguous.
+ *
+ * Mirrored ring maps its storage twice back to back, so any window of
+ * up to capacity bytes is contiguous in memory and may be handed to
+ * parser as is.
+ *
+ */
+
+#ifndef __RBBYTES_HEADER__
+#define __RBBYTES_HEADER__
+
+#include <stdlib.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Byte ring buffer.
+ */
+typedef struct _rbbytes_* RBBYTES;
+
+/**
+ * Byte ring buffer modes.
+ */
+enum _rbb_flags_ {
+  RBB_DEFAULT = 0, /**< Storage is allocated on heap */
+  RBB_MIRROR = 1 /**< Storage is memory file mapped twice, capacity is at least page size, Linux only */
+};
+
+/**
+ * Create new byte ring buffer.
+ *
+ * @param icap capacity in bytes, rounded up to power of two, at least 16
+ * @return new ring buffer or zero on error
+ */
+RBBYTES rbbInit(size_t icap);
+
+/**
+ * Create new byte ring buffer with defined mode.
+ *
+ * In mirrored mode rbbReserve and rbbPeek return all free and all
+ * stored bytes in one piece and records never need padding.
+ *
+ * @param icap capacity in bytes, rounded up to power of two, at least 16
+ * @param flags combination of _rbb_flags_
+ * @return new ring buffer or zero on error, including unsupported mode
+ */
+RBBYTES rbbInitEx(size_t icap, uint32_t flags);
+
+/**
+ * Cleanup ring buffer.
+ *
+ * After this function invocation, pointer to buffer == 0.
+ *
+ * @param rb pointer to ring buffer
+ */
+void rbbCleanup(RBBYTES* rb);
+
+/**
+ * Remove all data from buffer.
+ *
+ * @param rb ring buffer
+ */
+void rbbReset(RBBYTES rb);
+
+/**
+ * Get ring buffer capacity in bytes.
+ *
+ * @param rb ring buffer
+ */
+size_t rbbCap(const RBBYTES rb);
+
+/**
+ * Get number of used bytes, including record headers and padding.
+ *
+ * @param rb ring buffer
+ */
+size_t rbbSize(const RBBYTES rb);
+
+/**
+ * Reserve contiguous free space for byte stream.
+ *
+ * @param rb ring buffer
+ * @param n on return, number of reserved bytes
+ * @return pointer to reserved space or zero if buffer is full
+ */
+void* rbbReserve(RBBYTES rb, size_t* n);
+
+/**
+ * Publish bytes written to reserved space.
+ *
+ * @param rb ring buffer
+ * @param n number of written bytes, not more than reserved
+ * @return 0 on success, -1 on error
+ */
+int rbbCommit(RBBYTES rb, size_t n);
+
+/**
+ * Get contiguous part of stored bytes.
+ *
+ * @param rb ring buffer
+ * @param n on return, number of bytes available at returned pointer
+ * @return pointer to first stored byte or zero if buffer is empty
+ */
+const void* rbbPeek(const RBBYTES rb, size_t* n);
+
+/**
+ * Drop bytes from buffer front.
+ *
+ * @param rb ring buffer
+ * @param n number of bytes to drop, not more than stored
+ * @return 0 on success, -1 on error
+ */
+int rbbConsume(RBBYTES rb, size_t n);
+
+/**
+ * Copy bytes to the end of buffer.
+ *
+ * @param rb ring buffer
+ * @param data bytes to copy
+ * @param n number of bytes
+ * @return number of copied bytes, less than n, if buffer is full
+ */
+size_t rbbWrite(RBBYTES rb, const void* data, size_t n);
+
+/**
+ * Copy bytes from buffer front and drop them.
+ *
+ * @param rb ring buffer
+ * @param data where to copy bytes
+ * @param n maximum number of bytes
+ * @return number of copied bytes
+ */
+size_t rbbRead(RBBYTES rb, void* data, size_t n);
+
+/**
+ * Reserve space for record.
+ *
+ * Record payload is 8 bytes aligned.
+ *
+ * @param rb ring buffer
+ * @param n maximum record size
+ * @return pointer to record payload or zero if record does not fit
+ */
+void* rbbRecordReserve(RBBYTES rb, size_t n);
+
+/**
+ * Publish reserved record.
+ *
+ * @param rb ring buffer
+ * @param n actual record size, not more than reserved
+ * @return 0 on success, -1 on error
+ */
+int rbbRecordCommit(RBBYTES rb, size_t n);
+
+/**
+ * Get first record.
+ *
+ * @param rb ring buffer
+ * @param n on return, record size
+ * @return pointer to record payload or zero if buffer is empty
+ */
+const void* rbbRecordPeek(const RBBYTES rb, size_t* n);
+
+/**
+ * Drop first record.
+ *
+ * @param rb ring buffer
+ * @return 0 on success, -1 if buffer is empty
+ */
+int rbbRecordConsume(RBBYTES rb);
+
+/**
+ * Copy record to the end of buffer.
+ *
+ * @param rb ring buffer
+ * @param data record payload
+ * @param n record size
+ * @return 0 on success, -1 if record does not fit
+ */
+int rbbRecordPush(RBBYTES rb, const void* data, size_t n);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __RBBYTES_HEADER__ */
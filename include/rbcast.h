@@ -0,0 +1,157 @@
+/**
+ * @file rbcast.h
+ * @author masscry
+ *
+ * Broadcast ring buffer, where every reader sees every item.
+ *
+ * Producers claim sequence numbers and publish items into slots. Every
+ * registered reader moves its own cursor, so one write feeds many
+ * readers without copies. Slot is reused only after slowest reader
+ * passed it. Reader may depend on other readers and then sees only
+ * items, which they already processed, so readers form pipeline.
+ *
+ */
+
+#ifndef __RBCAST_HEADER__
+#define __RBCAST_HEADER__
+
+#include <stdlib.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Broadcast ring buffer.
+ */
+typedef struct _rbcast_* RBCAST;
+
+/**
+ * Registered reader, used by one thread.
+ */
+typedef struct _rbcast_reader_* RBCREADER;
+
+/**
+ * Create new broadcast ring.
+ *
+ * @param icap capacity, rounded up to power of two
+ * @return new ring or zero on error
+ */
+RBCAST rbcastInit(size_t icap);
+
+/**
+ * Delete ring and all its readers.
+ *
+ * All producers and readers must stop using ring before. After this
+ * function invocation, pointer to ring == 0.
+ *
+ * @param rb pointer to ring
+ */
+void rbcastCleanup(RBCAST* rb);
+
+/**
+ * Get ring capacity.
+ *
+ * @param rb ring
+ */
+size_t rbcastCap(const RBCAST rb);
+
+/**
+ * Register reader.
+ *
+ * Reader starts at next unclaimed sequence number. Readers must be
+ * registered before producers start, so no item is missed and no slot
+ * is reused under new reader.
+ *
+ * @param rb ring
+ * @param deps readers, which must process item before this one
+ * @param ndeps number of dependencies
+ * @return new reader or zero on error
+ */
+RBCREADER rbcastAttach(RBCAST rb, const RBCREADER* deps, size_t ndeps);
+
+/**
+ * Claim sequence number, if its slot is free.
+ *
+ * Claimed number must be published with rbcastPublish, readers wait for
+ * sequence numbers in order.
+ *
+ * @param rb ring
+ * @param seq on return, claimed sequence number
+ * @return 0 on success, -1 if ring is full
+ */
+int rbcastTryClaim(RBCAST rb, uint64_t* seq);
+
+/**
+ * Claim sequence number, waiting while ring is full.
+ *
+ * @param rb ring
+ * @param seq on return, claimed sequence number
+ * @return 0 on success, -1 on error
+ */
+int rbcastClaim(RBCAST rb, uint64_t* seq);
+
+/**
+ * Store item in claimed slot and make it visible to readers.
+ *
+ * Every claimed number is published once. Numbers not claimed yet,
+ * already published, or whose slot was published by later lap are
+ * rejected.
+ *
+ * @param rb ring
+ * @param seq claimed sequence number
+ * @param data item
+ * @return 0 on success, -1 on error
+ */
+int rbcastPublish(RBCAST rb, uint64_t seq, void* data);
+
+/**
+ * Claim, store and publish item, if ring is not full.
+ *
+ * @param rb ring
+ * @param data item
+ * @return 0 on success, -1 if ring is full
+ */
+int rbcastTryPush(RBCAST rb, void* data);
+
+/**
+ * Claim, store and publish item, waiting while ring is full.
+ *
+ * @param rb ring
+ * @param data item
+ * @return 0 on success, -1 on error
+ */
+int rbcastPush(RBCAST rb, void* data);
+
+/**
+ * Read available items and move reader cursor past them.
+ *
+ * @param rd reader
+ * @param data where to store items
+ * @param n maximum number of items
+ * @return number of read items
+ */
+size_t rbcastPoll(RBCREADER rd, void** data, size_t n);
+
+/**
+ * Read next item, waiting while it is not available.
+ *
+ * @param rd reader
+ * @param data where to store item, may be zero
+ * @return 0 on success, -1 on error
+ */
+int rbcastRead(RBCREADER rd, void** data);
+
+/**
+ * Get sequence number of next item to be read by reader.
+ *
+ * @param rd reader
+ */
+uint64_t rbcastCursor(const RBCREADER rd);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __RBCAST_HEADER__ */
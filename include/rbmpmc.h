@@ -0,0 +1,108 @@
+/**
+ * @file rbmpmc.h
+ * @author masscry
+ *
+ * Bounded multi-producer/multi-consumer queue.
+ *
+ * Every slot carries sequence number, which tells whether slot is ready
+ * for producer or for consumer of given lap. Producers and consumers
+ * claim positions with compare-and-swap on their own cache line and
+ * never take global lock.
+ *
+ */
+
+#ifndef __RBMPMC_HEADER__
+#define __RBMPMC_HEADER__
+
+#include <stdlib.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Multi-producer/multi-consumer queue.
+ */
+typedef struct _rbmpmc_* RBMPMC;
+
+/**
+ * Create new queue.
+ *
+ * @param icap capacity, rounded up to power of two, at least 2
+ * @return new queue or zero on error
+ */
+RBMPMC rbmpmcInit(size_t icap);
+
+/**
+ * Cleanup queue.
+ *
+ * All producers and consumers must stop using queue before. After this
+ * function invocation, pointer to queue == 0.
+ *
+ * @param rb pointer to queue
+ */
+void rbmpmcCleanup(RBMPMC* rb);
+
+/**
+ * Get queue capacity.
+ *
+ * @param rb queue
+ */
+size_t rbmpmcCap(const RBMPMC rb);
+
+/**
+ * Get approximate number of items in queue.
+ *
+ * Includes items claimed by producers, but not yet written, and items
+ * claimed by consumers, but not yet read.
+ *
+ * @param rb queue
+ */
+size_t rbmpmcSize(const RBMPMC rb);
+
+/**
+ * Add element to queue, if it is not full.
+ *
+ * @param rb queue
+ * @param data data to store
+ * @return 0 on success, -1 if queue is full
+ */
+int rbmpmcTryPush(RBMPMC rb, void* data);
+
+/**
+ * Pop element from queue, if it is not empty.
+ *
+ * @param rb queue
+ * @param data where to store popped data, may be zero
+ * @return 0 on success, -1 if queue is empty
+ */
+int rbmpmcTryPop(RBMPMC rb, void** data);
+
+/**
+ * Add element to queue, waiting while it is full.
+ *
+ * Waits by spinning for a while and then yielding processor.
+ *
+ * @param rb queue
+ * @param data data to store
+ * @return 0 on success, -1 on error
+ */
+int rbmpmcPush(RBMPMC rb, void* data);
+
+/**
+ * Pop element from queue, waiting while it is empty.
+ *
+ * Waits by spinning for a while and then yielding processor.
+ *
+ * @param rb queue
+ * @param data where to store popped data, may be zero
+ * @return 0 on success, -1 on error
+ */
+int rbmpmcPop(RBMPMC rb, void** data);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __RBMPMC_HEADER__ */
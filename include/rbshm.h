@@ -0,0 +1,176 @@
+/**
+ * @file rbshm.h
+ * @author masscry
+ *
+ * Ring buffer in shared memory for exchanging records between processes.
+ *
+ * Whole ring, including indexes, lives in one shared memory object and
+ * refers to its slots by index only, so every process may map it at
+ * any address. Slots carry sequence numbers, as in RBMPMC, so any number
+ * of producers and consumers in any processes work without locks and
+ * without system calls.
+ *
+ * Records have fixed maximum size. Every record is copied once, when
+ * written to slot, readers may process it in place.
+ *
+ */
+
+#ifndef __RBSHM_HEADER__
+#define __RBSHM_HEADER__
+
+#include <stdlib.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Shared memory ring buffer, handle is local to process.
+ */
+typedef struct _rbshm_* RBSHM;
+
+/**
+ * Create new shared memory ring.
+ *
+ * @param name shm_open object name, like "/name", or zero for anonymous memfd
+ * @param icap capacity in records, rounded up to power of two, at least 2
+ * @param isize maximum record size in bytes
+ * @return new ring or zero on error, including existing object with same name
+ */
+RBSHM rbshmCreate(const char* name, size_t icap, size_t isize);
+
+/**
+ * Attach to ring created by other process.
+ *
+ * @param name shm_open object name
+ * @return ring or zero on error
+ */
+RBSHM rbshmOpen(const char* name);
+
+/**
+ * Attach to ring by file descriptor, inherited or received from other process.
+ *
+ * Ring keeps its own duplicate of descriptor.
+ *
+ * @param fd shared memory file descriptor
+ * @return ring or zero on error
+ */
+RBSHM rbshmOpenFd(int fd);
+
+/**
+ * Detach from ring.
+ *
+ * Shared memory is freed, when last process detached and name is
+ * unlinked. After this function invocation, pointer to ring == 0.
+ *
+ * @param rb pointer to ring
+ */
+void rbshmCleanup(RBSHM* rb);
+
+/**
+ * Remove shared memory object name.
+ *
+ * @param name shm_open object name
+ * @return 0 on success, -1 on error
+ */
+int rbshmUnlink(const char* name);
+
+/**
+ * Get file descriptor of shared memory object, owned by ring.
+ *
+ * @param rb ring
+ * @return file descriptor or -1
+ */
+int rbshmFd(const RBSHM rb);
+
+/**
+ * Get ring capacity in records.
+ *
+ * @param rb ring
+ */
+size_t rbshmCap(const RBSHM rb);
+
+/**
+ * Get maximum record size.
+ *
+ * @param rb ring
+ */
+size_t rbshmItemSize(const RBSHM rb);
+
+/**
+ * Get approximate number of records in ring.
+ *
+ * @param rb ring
+ */
+size_t rbshmSize(const RBSHM rb);
+
+/**
+ * Claim slot to write record in place.
+ *
+ * @param rb ring
+ * @param ticket on return, slot ticket for rbshmCommit
+ * @return record memory of rbshmItemSize bytes or zero if ring is full
+ */
+void* rbshmReserve(RBSHM rb, uint64_t* ticket);
+
+/**
+ * Publish record written to claimed slot.
+ *
+ * Every successful rbshmReserve must be followed by commit, consumers
+ * wait for slots in order.
+ *
+ * @param rb ring
+ * @param ticket slot ticket
+ * @param size record size
+ * @return 0 on success, -1 on error
+ */
+int rbshmCommit(RBSHM rb, uint64_t ticket, size_t size);
+
+/**
+ * Claim first record to read it in place.
+ *
+ * Record size is written by producer in shared memory, so it is
+ * clamped to rbshmItemSize of this handle.
+ *
+ * @param rb ring
+ * @param ticket on return, slot ticket for rbshmRelease
+ * @param size on return, record size, may be zero
+ * @return record memory or zero if ring is empty
+ */
+const void* rbshmPeek(RBSHM rb, uint64_t* ticket, size_t* size);
+
+/**
+ * Return claimed slot to producers.
+ *
+ * @param rb ring
+ * @param ticket slot ticket
+ * @return 0 on success, -1 on error
+ */
+int rbshmRelease(RBSHM rb, uint64_t ticket);
+
+/**
+ * Copy record to ring.
+ *
+ * @param rb ring
+ * @param data record
+ * @param size record size, not more than rbshmItemSize
+ * @return 0 on success, -1 if ring is full or record is too big
+ */
+int rbshmPush(RBSHM rb, const void* data, size_t size);
+
+/**
+ * Copy first record from ring and remove it.
+ *
+ * @param rb ring
+ * @param data where to copy record, at least rbshmItemSize bytes
+ * @param size on return, record size, may be zero
+ * @return 0 on success, -1 if ring is empty
+ */
+int rbshmPop(RBSHM rb, void* data, size_t* size);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __RBSHM_HEADER__ */
@@ -0,0 +1,141 @@
+/**
+ * @file rbspsc.h
+ * @author masscry
+ *
+ * Lock-free single-producer/single-consumer ring buffer.
+ *
+ * Exactly one thread pushes and exactly one thread pops, no locks are
+ * taken. Producer and consumer indexes live on separate cache lines and
+ * every side keeps cached copy of other side index, so shared lines are
+ * touched only when ring looks full or empty.
+ *
+ * Unlike RBUF, full ring never overwrites old items, push fails instead.
+ *
+ * Blocking ring lets consumer sleep on futex, while ring is empty.
+ * Producer makes system call only when it puts item to empty ring with
+ * sleeping consumer. Ring may also signal such transitions through
+ * eventfd, so consumer can wait in epoll next to sockets.
+ *
+ */
+
+#ifndef __RBSPSC_HEADER__
+#define __RBSPSC_HEADER__
+
+#include <stdlib.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Single-producer/single-consumer ring buffer.
+ */
+typedef struct _rbspsc_* RBSPSC;
+
+/**
+ * SPSC ring buffer modes.
+ */
+enum _rbspsc_flags_ {
+  RBSPSC_DEFAULT = 0, /**< Both sides only poll */
+  RBSPSC_BLOCKING = 1, /**< Consumer may wait with rbspscPopWait, Linux only */
+  RBSPSC_EVENTFD = 2 /**< Blocking ring, which also signals eventfd, Linux only */
+};
+
+/**
+ * Create new ring buffer.
+ *
+ * @param icap capacity, rounded up to power of two
+ * @return new ring buffer or zero on error
+ */
+RBSPSC rbspscInit(size_t icap);
+
+/**
+ * Create new ring buffer with defined mode.
+ *
+ * @param icap capacity, rounded up to power of two
+ * @param flags combination of _rbspsc_flags_
+ * @return new ring buffer or zero on error, including unsupported mode
+ */
+RBSPSC rbspscInitEx(size_t icap, uint32_t flags);
+
+/**
+ * Cleanup ring buffer.
+ *
+ * Both sides must stop using ring before. After this function
+ * invocation, pointer to buffer == 0.
+ *
+ * @param rb pointer to ring buffer
+ */
+void rbspscCleanup(RBSPSC* rb);
+
+/**
+ * Get ring buffer capacity.
+ *
+ * @param rb ring buffer
+ */
+size_t rbspscCap(const RBSPSC rb);
+
+/**
+ * Get number of items in ring buffer.
+ *
+ * Exact only when called by producer or consumer, other threads get
+ * snapshot, which may be outdated.
+ *
+ * @param rb ring buffer
+ */
+size_t rbspscSize(const RBSPSC rb);
+
+/**
+ * Add element to the end of buffer.
+ *
+ * Must be called by producer thread only.
+ *
+ * @param rb ring buffer
+ * @param data data to store
+ * @return 0 on success, -1 if buffer is full
+ */
+int rbspscPush(RBSPSC rb, void* data);
+
+/**
+ * Pop element from the buffer front.
+ *
+ * Must be called by consumer thread only.
+ *
+ * @param rb ring buffer
+ * @param data where to store popped data, may be zero
+ * @return 0 on success, -1 if buffer is empty
+ */
+int rbspscPop(RBSPSC rb, void** data);
+
+/**
+ * Pop element from the buffer front, waiting while buffer is empty.
+ *
+ * Must be called by consumer thread of blocking ring only. Spins for a
+ * short while and then sleeps on futex until producer adds element.
+ *
+ * @param rb ring buffer
+ * @param data where to store popped data, may be zero
+ * @param timeout maximum wait in milliseconds, negative waits forever
+ * @return 0 on success, -1 on timeout or error
+ */
+int rbspscPopWait(RBSPSC rb, void** data, int timeout);
+
+/**
+ * Get event file descriptor of ring created with RBSPSC_EVENTFD.
+ *
+ * Descriptor becomes readable, when element is added to ring, which
+ * consumer found empty. Consumer, woken by poll or epoll, must pop until
+ * rbspscPop fails, failed pop drains descriptor and arms it again.
+ * Descriptor is owned by ring.
+ *
+ * @param rb ring buffer
+ * @return event file descriptor or -1
+ */
+int rbspscEventFd(const RBSPSC rb);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __RBSPSC_HEADER__ */
@@ -29,6 +29,22 @@ typedef struct _rbuf_* RBUF;
 
 typedef void (*rbufCleanupFunc)(void* value);
 
+/**
+ * Contiguous part of ring buffer storage.
+ */
+typedef struct _rbuf_span_ {
+  void** data; /**< Stored values */
+  size_t count; /**< Number of values */
+} rbufSpan;
+
+/**
+ * Ring buffer modes.
+ */
+enum _rbuf_flags_ {
+  RBUF_DEFAULT = 0, /**< Capacity is used as is */
+  RBUF_POW2 = 1 /**< Capacity is rounded up to power of two, slots are found by mask */
+};
+
 /**
  * Create new ring buffer with defined capacity.
  * @param icap Ring buffer capacity
@@ -36,6 +52,34 @@ typedef void (*rbufCleanupFunc)(void* value);
  */
 RBUF rbufInit(size_t icap);
 
+/**
+ * Create new ring buffer with defined capacity and mode.
+ *
+ * Items are addressed by 64-bit sequence numbers, which never wrap in
+ * practice. Power of two capacity turns every slot lookup into single
+ * mask, other capacities need division.
+ *
+ * @param icap Ring buffer capacity
+ * @param flags combination of _rbuf_flags_
+ * @return new ring buffer or zero on error
+ */
+RBUF rbufInitEx(size_t icap, uint32_t flags);
+
+/**
+ * Create new ring buffer, which stores items of fixed size in its own storage.
+ *
+ * Item values are pointers to item storage, which is 8 bytes aligned
+ * and lives as long as ring. rbufPushBack copies item bytes, items may
+ * also be built in place with rbufReserve and rbufCommit. rbufSetValue
+ * must not be used on such ring.
+ *
+ * @param icap Ring buffer capacity
+ * @param flags combination of _rbuf_flags_
+ * @param isize item size in bytes, zero makes ordinary pointer ring
+ * @return new ring buffer or zero on error
+ */
+RBUF rbufInitSized(size_t icap, uint32_t flags, size_t isize);
+
 /**
  * Remove all data from buffer.
  * @param RBUF ring buffer
@@ -68,11 +112,56 @@ size_t rbufCap(const RBUF rbuf);
 /**
  * Add element to the end of buffer.
  *
+ * When ring has own storage, data points to item bytes to copy, zero
+ * data stores zeroed item.
+ *
  * @param rbuf ring buffer
  * @param data data to store
+ * @return stored item, or zero on error or while element is reserved
  */
 RBITEM rbufPushBack(RBUF rbuf, void* data);
 
+/**
+ * Get memory for next element to build it in place.
+ *
+ * Returns item storage for ring with own storage and pointer slot for
+ * ordinary ring. Element becomes visible after rbufCommit. When buffer
+ * is full, oldest element is dropped. Cleanup function is called as in
+ * rbufPushBack. Only one element may be reserved at a time, so
+ * rbufReserve, rbufPushBack and rbufPushBackN fail until rbufCommit.
+ *
+ * @param rbuf ring buffer
+ * @return memory for element, or zero on error or while element is reserved
+ */
+void* rbufReserve(RBUF rbuf);
+
+/**
+ * Add reserved element to the end of buffer.
+ *
+ * @param rbuf ring buffer
+ * @return 0 on success, -1 if nothing is reserved
+ */
+int rbufCommit(RBUF rbuf);
+
+/**
+ * Get memory of first element without removing it.
+ *
+ * Returns item storage for ring with own storage and pointer slot for
+ * ordinary ring.
+ *
+ * @param rbuf ring buffer
+ * @return memory of element or zero if buffer is empty
+ */
+void* rbufPeek(const RBUF rbuf);
+
+/**
+ * Remove first element, after it was processed in place.
+ *
+ * @param rbuf ring buffer
+ * @return 0 on success, -1 if buffer is empty
+ */
+int rbufRelease(RBUF rbuf);
+
 /**
  * Pop element from the buffer front.
  *
@@ -81,6 +170,43 @@ RBITEM rbufPushBack(RBUF rbuf, void* data);
  */
 void* rbufPopFront(RBUF rbuf);
 
+/**
+ * Add several elements to the end of buffer.
+ *
+ * Works as rbufPushBack called for every element, but copies whole
+ * contiguous runs, when no cleanup function is set.
+ *
+ * @param rbuf ring buffer
+ * @param data data to store
+ * @param n number of elements in data
+ * @return number of stored elements, zero while element is reserved
+ */
+size_t rbufPushBackN(RBUF rbuf, void* const* data, size_t n);
+
+/**
+ * Pop several elements from the buffer front.
+ *
+ * @param rbuf ring buffer
+ * @param data where to store popped data, may be zero to just drop elements
+ * @param n maximum number of elements to pop
+ * @return number of popped elements
+ */
+size_t rbufPopFrontN(RBUF rbuf, void** data, size_t n);
+
+/**
+ * Get contiguous parts of storage, which hold range of elements.
+ *
+ * Range wraps at most once, so it takes two spans at most. Spans
+ * stay valid until buffer is modified.
+ *
+ * @param rbuf ring buffer
+ * @param index position of first element counted from buffer front
+ * @param n number of elements, clipped to buffer size
+ * @param spans array of two spans to fill
+ * @return number of filled spans
+ */
+int rbufSpans(const RBUF rbuf, size_t index, size_t n, rbufSpan* spans);
+
 /**
  * Get first ring buffer element.
  *
@@ -97,6 +223,15 @@ RBITEM rbufFront(const RBUF rbuf);
  */
 RBITEM rbufBack(const RBUF rbuf);
 
+/**
+ * Get ring buffer element by its position.
+ *
+ * @param rbuf ring buffer
+ * @param index position counted from first element
+ * @return item with stored data or zero if index is out of range
+ */
+RBITEM rbufAt(const RBUF rbuf, size_t index);
+
 /**
  * Get next buffer element.
  *
@@ -136,6 +271,9 @@ int rbufSetValue(RBITEM item, void* value);
  * Set cleanup function.
  *
  * Cleanup function called when buffer start to overwrite old items.
+ * Ordinary ring passes stored pointer, whenever its slot is reused.
+ * Ring with own storage passes pointer to item storage of dropped
+ * element, before it is overwritten, popped elements are not passed.
  *
  * @param rbuf ring buffer
  * @param func cleanup function
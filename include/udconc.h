@@ -0,0 +1,127 @@
+/**
+ * @file udconc.h
+ * @author masscry
+ *
+ * Read-mostly hash table with lock-free readers.
+ *
+ * Readers never take locks and never write cache lines shared with
+ * other threads. Writers are serialized by mutex, publish new items
+ * with release stores and replace whole table, when it grows. Old
+ * tables are freed after every reader left read section started before
+ * replacement (epoch based grace period).
+ *
+ */
+
+#ifndef __UDCONC_HEADER__
+#define __UDCONC_HEADER__
+
+#include <stdlib.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Concurrent hash table.
+ */
+typedef struct _udconc_* UDCONC;
+
+/**
+ * Reader registration, one per reading thread.
+ */
+typedef struct _udconc_reader_* UDCREADER;
+
+/**
+ * Create new concurrent hash table.
+ *
+ * @param icap initial capacity, rounded up to power of two
+ * @return new table or zero on error
+ */
+UDCONC udcInit(uint32_t icap);
+
+/**
+ * Delete concurrent hash table.
+ *
+ * All readers must be detached before.
+ *
+ * @param uc pointer to table
+ */
+void udcCleanup(UDCONC* uc);
+
+/**
+ * Get number of items in table.
+ */
+uint32_t udcSize(const UDCONC uc);
+
+/**
+ * Insert new item or replace value of existing one.
+ *
+ * Safe to call from any thread, but not inside read section, since
+ * growing table waits for all read sections to end.
+ *
+ * @param uc table
+ * @param key item key
+ * @param value item value
+ * @return 0 on success, -1 on error
+ */
+int udcReset(UDCONC uc, uint32_t key, void* value);
+
+/**
+ * Register reading thread.
+ *
+ * @param uc table
+ * @return reader or zero on error
+ */
+UDCREADER udcAttach(UDCONC uc);
+
+/**
+ * Unregister reading thread.
+ *
+ * @param rd pointer to reader, set to zero after call
+ */
+void udcDetach(UDCREADER* rd);
+
+/**
+ * Enter read section.
+ *
+ * Table seen inside read section is never freed before udcReadEnd.
+ * Read sections are not nested.
+ *
+ * @param rd reader
+ */
+void udcReadBegin(UDCREADER rd);
+
+/**
+ * Leave read section.
+ *
+ * @param rd reader
+ */
+void udcReadEnd(UDCREADER rd);
+
+/**
+ * Find value in table. Must be called inside read section.
+ *
+ * @param rd reader
+ * @param key key to find
+ * @param value found value
+ * @return 1 when key found, 0 otherwise
+ */
+int udcFind(UDCREADER rd, uint32_t key, void** value);
+
+/**
+ * Get value from table in its own read section.
+ *
+ * WARNING: No way to detect that key actually exists.
+ *
+ * @param rd reader
+ * @param key key to find
+ * @return found value or zero
+ */
+void* udcGet(UDCREADER rd, uint32_t key);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __UDCONC_HEADER__ */
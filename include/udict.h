@@ -29,19 +29,195 @@ typedef struct _udict_item_* UDITEM;
  */
 typedef struct _udict_* UDICT;
 
+/**
+ * Hash table modes.
+ */
+enum _udict_flags_ {
+  UD_DEFAULT     = 0, /**< Fixed capacity, grow only with udRehash */
+  UD_INCREMENTAL = 1, /**< Grow automatically, migrating items in small steps */
+  UD_ROBINHOOD   = 2, /**< Robin Hood insertion, keeps probe lengths even */
+  UD_SOA         = 4, /**< Keys and values in separate arrays */
+  UD_INLINE      = 8, /**< Values stored in buckets, set by udInitInline */
+  UD_READONLY    = 16 /**< Mapped from file, set by udMapFile */
+};
+
+/**
+ * Maximum size of value stored in UD_INLINE table.
+ */
+#define UD_INLINE_MAX (32)
+
+/**
+ * Key hashing policy.
+ *
+ * Home bucket of key is taken from low bits of its hash.
+ */
+typedef uint32_t (*udHashFunc)(uint32_t key);
+
+/**
+ * Default hashing policy, MurmurHash3 32-bit finalizer.
+ *
+ * Spreads sequential or structured keys uniformly over buckets.
+ */
+uint32_t udHashMix(uint32_t key);
+
+/**
+ * Hashing policy for keys, which are already good hashes.
+ */
+uint32_t udHashIdentity(uint32_t key);
+
+/**
+ * Number of udStats_t histogram buckets.
+ */
+#define UD_STATS_BUCKETS (16)
+
+/**
+ * Hash table statistics, filled by udStats.
+ *
+ * Operation counters are collected only when library is built with
+ * UD_STATS_COUNTERS defined (ALPHA0_UDICT_COUNTERS option).
+ */
+typedef struct _udict_stats_ {
+  uint32_t size; /**< Number of items */
+  uint32_t cap; /**< Number of buckets */
+  uint32_t probe[UD_STATS_BUCKETS]; /**< Items by distance from home bucket, last entry counts longer ones too */
+  uint32_t maxProbe; /**< Longest distance from home bucket */
+  double meanProbe; /**< Mean distance from home bucket */
+  uint32_t cluster[UD_STATS_BUCKETS]; /**< Runs of active buckets, entry i counts lengths in [2^i, 2^(i+1)) */
+  uint32_t clusters; /**< Number of runs */
+  uint32_t maxCluster; /**< Longest run */
+  double meanCluster; /**< Mean run length */
+  uint32_t dupKeys; /**< Keys stored more than once */
+  uint32_t dupItems; /**< Items with such keys */
+  uint32_t maxDupChain; /**< Longest udNext chain */
+  uint32_t wrapped; /**< Items wrapped around table end from their home bucket */
+  int counters; /**< Non zero, when counters below are collected */
+  uint64_t lookups; /**< Table lookups */
+  uint64_t probes; /**< Control byte groups, or Robin Hood buckets, tested */
+  uint64_t inserts; /**< Table insertions, including migrated items */
+  uint64_t rehashes; /**< UD_INCREMENTAL growths and udRehash calls */
+  uint64_t wraps; /**< Probes wrapped around table end */
+} udStats_t;
+
 /**
  * Create new hash table.
  *
- * @param icap initial capacity
+ * @param icap initial capacity, rounded up to power of two
  *
  */
 UDICT udInit(uint32_t icap);
 
+/**
+ * Create new hash table in given mode.
+ *
+ * UD_INCREMENTAL table doubles its capacity when it is 7/8 full. Old and
+ * new buckets coexist while every udInsert/udReset/udRemove moves a few
+ * old buckets to new ones, so no single call pays for whole table
+ * rehashing. Lookups never move items, so they are safe during iteration
+ * and from several reading threads.
+ *
+ * UD_ROBINHOOD table stores probe distance of every item. Inserted item
+ * takes bucket of any item, which is closer to its home, so lookups stop
+ * as soon as they meet such item. Useful at 85-90% load and with keys
+ * sharing low bits.
+ *
+ * UD_SOA table keeps keys in dense array apart from values, so probing
+ * touches 16 keys per cache line instead of 4 key-value pairs, and no
+ * padding is wasted between key and value. UDITEM of UD_SOA table
+ * points to value only, so use udItemKey instead of udKey.
+ *
+ * WARNING: In UD_INCREMENTAL mode udInsert/udReset/udRemove may move items,
+ * in UD_ROBINHOOD mode udInsert/udReset may move items, so UDITEM stays
+ * valid only until next call to one of them.
+ *
+ * @param icap initial capacity, rounded up to power of two
+ * @param flags combination of _udict_flags_
+ */
+UDICT udInitEx(uint32_t icap, uint32_t flags);
+
+/**
+ * Create new hash table, which stores values in its buckets.
+ *
+ * Every udInsert/udReset data argument points to vsize bytes, which
+ * are copied into bucket, zero data means zero filled value. Items are
+ * accessed with udValuePtr, udGet returns pointer to value too. So
+ * counters and small structs need neither casts to void*, nor
+ * allocation per item.
+ *
+ * @param icap initial capacity, rounded up to power of two
+ * @param flags combination of _udict_flags_
+ * @param vsize value size, up to UD_INLINE_MAX bytes
+ * @return new table or zero on error
+ */
+UDICT udInitInline(uint32_t icap, uint32_t flags, uint32_t vsize);
+
+/**
+ * Build UD_INCREMENTAL hash table from arrays at once.
+ *
+ * Table is sized once for all items. Buckets are split into regions by
+ * high bits of bucket index, and every thread places items homed in its
+ * region, so threads never touch the same buckets. Items, which would
+ * cross region end, are placed after that, and duplicate counts are
+ * computed in the final pass, instead of on every probe as in udInsert.
+ *
+ * Equal keys keep input order for udNext, as if they were inserted with
+ * udInsert one by one.
+ *
+ * @param keys item keys
+ * @param values item values, zero means zero values
+ * @param n number of items
+ * @param threads number of threads to use, one means calling thread only
+ * @return new table or zero on error
+ */
+UDICT udBuildBulk(const uint32_t* keys, void* const* values, size_t n, uint32_t threads);
+
+/**
+ * Set key hashing policy.
+ *
+ * Policy can be changed only while table is empty.
+ *
+ * @param ud dict
+ * @param func new hashing policy
+ * @return old hashing policy, or zero on error
+ */
+udHashFunc udSetHashFunc(UDICT ud, udHashFunc func);
+
 /**
  * Create new hash table based on old one, but with differend capacity.
+ *
+ * New table inherits mode and hashing policy of old one.
  */
 UDICT udRehash(UDICT* old, uint32_t icap);
 
+/**
+ * Save hash table to file.
+ *
+ * File holds table arrays as they are in memory, so udMapFile needs no
+ * insertions to load it. Values are saved as is, so void* values make
+ * sense only for UD_INLINE tables or integers stored in pointers.
+ * Growth of UD_INCREMENTAL table is finished before saving.
+ *
+ * @param ud dict using udHashMix or udHashIdentity
+ * @param path file path
+ * @return 0 on success, -1 on error
+ */
+int udSave(UDICT ud, const char* path);
+
+/**
+ * Map hash table saved by udSave.
+ *
+ * Table is mapped read-only and shared, so many processes mapping the
+ * same file share its pages. Mapped table is UD_READONLY: udInsert,
+ * udReset, udRemove and udRemoveItem fail, udSetValue and writes
+ * through udValuePtr crash. udRehash makes writable copy.
+ *
+ * File must be saved by machine with the same byte order and pointer
+ * size, and with the same or larger control byte group.
+ *
+ * @param path file path
+ * @return mapped table or zero on error
+ */
+UDICT udMapFile(const char* path);
+
 /**
  * Delete hash table.
  */
@@ -54,13 +230,26 @@ typedef void (*udCleanupFunc)(UDITEM item);
  */
 void udCleanupDeep(UDICT* ud, udCleanupFunc func);
 
+/**
+ * Compute hash table statistics.
+ *
+ * Walks all buckets, so it is for diagnostics, not for hot paths.
+ *
+ * @param ud dict
+ * @param stats statistics
+ * @return 0 on success, -1 on error
+ */
+int udStats(const UDICT ud, udStats_t* stats);
+
 /**
  * Get table size.
  */
 uint32_t udSize(const UDICT ud);
 
 /**
- * Get table capacity
+ * Get table capacity.
+ *
+ * While UD_INCREMENTAL table grows, returns capacity of new buckets.
  */
 uint32_t udCap(const UDICT ud);
 
@@ -74,14 +263,54 @@ UDITEM udInsert(UDICT ud, uint32_t key, void* data);
  */
 UDITEM udReset(UDICT ud, uint32_t key, void* data);
 
+/**
+ * Remove all items with given key from hash table.
+ *
+ * Item values are not cleaned up.
+ *
+ * @param ud dict
+ * @param key key to remove
+ * @return number of removed items
+ */
+uint32_t udRemove(UDICT ud, uint32_t key);
+
+/**
+ * Remove single item from hash table.
+ *
+ * Items after removed one can be moved closer to their home buckets,
+ * so other UDITEMs become invalid.
+ *
+ * @param ud dict
+ * @param item item to remove
+ * @return 0 on success, -1 on error
+ */
+int udRemoveItem(UDICT ud, UDITEM item);
+
 /**
  * Find item in hash table.
  */
 UDITEM udFind(const UDICT ud, uint32_t key);
 
+/**
+ * Find many items in hash table at once.
+ *
+ * Home buckets of several keys are computed and prefetched before any
+ * of them is probed, so cache misses of different keys overlap instead
+ * of being paid one after another as in udFind loop.
+ *
+ * @param ud dict
+ * @param keys keys to find
+ * @param n number of keys
+ * @param out found items, zero for missing keys
+ * @return number of found keys
+ */
+size_t udFindBatch(const UDICT ud, const uint32_t* keys, size_t n, UDITEM* out);
+
 /**
  * Get item value from hash table.
  *
+ * Returns pointer to value in UD_INLINE table.
+ *
  * WARNING: No way to detect that key actually exists.
  *
  */
@@ -89,19 +318,41 @@ void* udGet(const UDICT ud, uint32_t key);
 
 /**
  * Get item key.
+ *
+ * Works only for tables without UD_SOA and UD_INLINE flags.
  */
 uint32_t udKey(const UDITEM item);
 
+/**
+ * Get item key in table of any layout.
+ *
+ * @param ud dict
+ * @param item item of this dict
+ * @return item key
+ */
+uint32_t udItemKey(const UDICT ud, const UDITEM item);
+
 /**
  * Get item value.
+ *
+ * Not for UD_INLINE tables.
  */
 void* udValue(const UDITEM item);
 
 /**
  * Replace item value.
+ *
+ * Not for UD_INLINE tables.
  */
 void udSetValue(UDITEM item, void* value);
 
+/**
+ * Get pointer to value stored in bucket.
+ *
+ * In UD_INLINE table it points to value itself, otherwise to void*.
+ */
+void* udValuePtr(const UDITEM item);
+
 /**
  * Find next item with equal key.
  */
@@ -0,0 +1,40 @@
+/**
+ * @file udict64.h
+ * @author masscry
+ *
+ * C hash table with 64-bit keys.
+ *
+ * Same as UDICT, but keys are uint64_t, so 64-bit string hashes or
+ * identifiers need no folding before insertion. Functions use "ud64"
+ * prefix instead of "ud", modes are _udict_flags_ from udict.h.
+ *
+ */
+
+#ifndef __UDICT64_HEADER__
+#define __UDICT64_HEADER__
+
+#include <udtempl.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+UDICT_DECLARE(UDICT64, UDITEM64, ud64, _udict64_, uint64_t)
+
+/**
+ * Default hashing policy, MurmurHash3 64-bit finalizer folded to 32 bits.
+ */
+uint32_t ud64HashMix(uint64_t key);
+
+/**
+ * Hashing policy for keys, which are already good hashes.
+ *
+ * Folds high half of key into low one.
+ */
+uint32_t ud64HashIdentity(uint64_t key);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __UDICT64_HEADER__ */
@@ -0,0 +1,103 @@
+/**
+ * @file udshard.h
+ * @author masscry
+ *
+ * Lock-striped hash table for multi-writer workloads.
+ *
+ * Keys are routed by high bits of key hash to independent UDICT shards,
+ * each with its own lock and incremental growth, so writers to
+ * different shards never wait for each other.
+ *
+ */
+
+#ifndef __UDSHARD_HEADER__
+#define __UDSHARD_HEADER__
+
+#include <stdlib.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Sharded hash table.
+ */
+typedef struct _udshard_* UDSHARD;
+
+/**
+ * Create new sharded hash table.
+ *
+ * @param icap initial capacity of whole table
+ * @param shards number of shards, rounded up to power of two, up to 1024
+ * @return new table or zero on error
+ */
+UDSHARD udsInit(uint32_t icap, uint32_t shards);
+
+/**
+ * Delete sharded hash table.
+ *
+ * @param uds pointer to table
+ */
+void udsCleanup(UDSHARD* uds);
+
+/**
+ * Get number of items in table.
+ *
+ * Shards are locked one after another, so result is exact only when
+ * no writers are active.
+ */
+uint32_t udsSize(UDSHARD uds);
+
+/**
+ * Get number of shards.
+ */
+uint32_t udsShards(const UDSHARD uds);
+
+/**
+ * Insert new item into table. Duplicate keys are allowed, like in udInsert.
+ *
+ * @param uds table
+ * @param key item key
+ * @param value item value
+ * @return 0 on success, -1 on error
+ */
+int udsInsert(UDSHARD uds, uint32_t key, void* value);
+
+/**
+ * Insert new item or replace value of existing one, like udReset.
+ *
+ * @param uds table
+ * @param key item key
+ * @param value item value
+ * @return 0 on success, -1 on error
+ */
+int udsReset(UDSHARD uds, uint32_t key, void* value);
+
+/**
+ * Find value in table.
+ *
+ * Items can move, when other threads change table, so value is copied
+ * under shard lock instead of returning UDITEM.
+ *
+ * @param uds table
+ * @param key key to find
+ * @param value found value, may be zero
+ * @return 1 when key found, 0 otherwise
+ */
+int udsFind(UDSHARD uds, uint32_t key, void** value);
+
+/**
+ * Remove all items with given key.
+ *
+ * @param uds table
+ * @param key key to remove
+ * @return number of removed items
+ */
+uint32_t udsRemove(UDSHARD uds, uint32_t key);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __UDSHARD_HEADER__ */
@@ -0,0 +1,72 @@
+/**
+ * @file udtempl.h
+ * @author masscry
+ *
+ * Declarations of UDICT family for other key widths.
+ *
+ * Every member has the same modes, layout and growth as UDICT from
+ * udict.h, only key type differs. Member is declared with
+ * UDICT_DECLARE and implemented by translation unit, which defines
+ * parameters listed in src/udict/udimpl.h and includes it.
+ *
+ */
+
+#ifndef __UDTEMPL_HEADER__
+#define __UDTEMPL_HEADER__
+
+#include <stdlib.h>
+#include <stdint.h>
+
+#include <udict.h>
+
+/**
+ * Declare hash table with fixed-width key.
+ *
+ * Every function is named as its udict.h counterpart with prefix
+ * instead of "ud" and works the same way.
+ *
+ * @param DICT table handle type name
+ * @param ITEM item handle type name
+ * @param prefix function name prefix
+ * @param tag struct tag, item struct tag is tag##item_
+ * @param KEY key type, its size must be multiple of 4 bytes
+ */
+#define UDICT_DECLARE(DICT, ITEM, prefix, tag, KEY) \
+  struct tag##item_; \
+  struct tag; \
+  typedef struct tag##item_* ITEM; \
+  typedef struct tag* DICT; \
+  typedef uint32_t (*prefix##HashFunc)(KEY key); \
+  typedef void (*prefix##CleanupFunc)(ITEM item); \
+  DICT prefix##Init(uint32_t icap); \
+  DICT prefix##InitEx(uint32_t icap, uint32_t flags); \
+  DICT prefix##InitInline(uint32_t icap, uint32_t flags, uint32_t vsize); \
+  DICT prefix##BuildBulk(const KEY* keys, void* const* values, size_t n, uint32_t threads); \
+  prefix##HashFunc prefix##SetHashFunc(DICT ud, prefix##HashFunc func); \
+  DICT prefix##Rehash(DICT* old, uint32_t icap); \
+  int prefix##Save(DICT ud, const char* path); \
+  DICT prefix##MapFile(const char* path); \
+  void prefix##Cleanup(DICT* ud); \
+  void prefix##CleanupDeep(DICT* ud, prefix##CleanupFunc func); \
+  uint32_t prefix##Size(const DICT ud); \
+  uint32_t prefix##Cap(const DICT ud); \
+  int prefix##Stats(const DICT ud, udStats_t* stats); \
+  ITEM prefix##Insert(DICT ud, KEY key, void* data); \
+  ITEM prefix##Reset(DICT ud, KEY key, void* data); \
+  uint32_t prefix##Remove(DICT ud, KEY key); \
+  int prefix##RemoveItem(DICT ud, ITEM item); \
+  ITEM prefix##Find(const DICT ud, KEY key); \
+  size_t prefix##FindBatch(const DICT ud, const KEY* keys, size_t n, ITEM* out); \
+  void* prefix##Get(const DICT ud, KEY key); \
+  KEY prefix##Key(const ITEM item); \
+  KEY prefix##ItemKey(const DICT ud, const ITEM item); \
+  void* prefix##Value(const ITEM item); \
+  void prefix##SetValue(ITEM item, void* value); \
+  void* prefix##ValuePtr(const ITEM item); \
+  ITEM prefix##Next(DICT ud, ITEM item); \
+  uint32_t prefix##Left(DICT ud, ITEM item); \
+  ITEM prefix##IterFirst(DICT ud); \
+  ITEM prefix##IterNext(DICT ud, ITEM item); \
+  ITEM prefix##IterLast(DICT ud);
+
+#endif /* __UDTEMPL_HEADER__ */
@@ -20,12 +20,15 @@ J2VAL j2InitObject() {
     return 0;
   }
 
-  dict = udInit(DICT_ICAP);
+  dict = udInitEx(DICT_ICAP, UD_INCREMENTAL);
   if (dict == 0) {
     free(result);
     return 0;
   }
 
+  // Keys are MurMur3 hashes already
+  udSetHashFunc(dict, udHashIdentity);
+
   result->type = J2_OBJECT;
   memcpy(result->data, &dict, sizeof(UDICT));
   return result;
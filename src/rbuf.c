@@ -1,27 +1,99 @@
 #include "rbuf.h"
+#include "rbuf/rbpriv.h"
 #include <stdio.h>
+#include <string.h>
 
 struct _rbuf_item_{
   void* data;
 };
 
+/**
+ * Ring buffer.
+ *
+ * Front and end are monotonic 64-bit sequence numbers, slot of sequence
+ * is found by mask, when capacity is power of two, or by division
+ * otherwise. Size is end - front and never exceeds capacity.
+ */
 struct _rbuf_ {
   RBITEM data;
   size_t cap;
-  size_t start;
-  size_t end;
-  size_t size;
+  size_t mask; /**< Capacity - 1, valid when pow2 is set */
+  int pow2; /**< Capacity is power of two */
+  uint64_t front; /**< Sequence number of first item */
+  uint64_t end; /**< Sequence number after last item */
   rbufCleanupFunc clean;
+  uint8_t* storage; /**< Item storage owned by ring, zero if ring stores pointers */
+  size_t isize; /**< Size of item in storage */
+  int reserved; /**< Back slot is reserved and not committed yet */
 };
 
+/**
+ * Round item size, so every item in storage is 8 bytes aligned.
+ */
+#define RBUF_ITEM_ALIGN(n) (((n) + 7) & ~((size_t)7))
+
+/**
+ * Get memory holding item value.
+ *
+ * Pointer ring keeps value in item itself, ring with own storage keeps
+ * value in storage and item points there.
+ */
+static INLINE void* rbufItemMemory(const RBUF rbuf, RBITEM item){
+  if (rbuf->storage != 0){
+    return item->data;
+  }
+  return &item->data;
+}
+
+static INLINE size_t rbufSlot(const RBUF rbuf, uint64_t seq){
+  if (rbuf->pow2){
+    return (size_t)(seq & rbuf->mask);
+  }
+  return (size_t)(seq % rbuf->cap);
+}
+
+/**
+ * Get distance from first item to given one.
+ *
+ * @return distance, or value not less than size, if item is not in buffer
+ */
+static INLINE size_t rbufOffset(const RBUF rbuf, const RBITEM item){
+  size_t index = 0;
+  size_t first = 0;
+
+  if ((item < rbuf->data) || (item >= rbuf->data + rbuf->cap)){
+    return rbuf->cap;
+  }
+  index = (size_t)(item - rbuf->data);
+  first = rbufSlot(rbuf, rbuf->front);
+  if (index < first){
+    return index + rbuf->cap - first;
+  }
+  return index - first;
+}
+
 RBUF rbufInit(size_t icap){
-  RBUF result = (RBUF)malloc(sizeof(struct _rbuf_));
-  if (result == 0){
-    return 0;
+  return rbufInitEx(icap, RBUF_DEFAULT);
+}
+
+RBUF rbufInitEx(size_t icap, uint32_t flags){
+  return rbufInitSized(icap, flags, 0);
+}
+
+RBUF rbufInitSized(size_t icap, uint32_t flags, size_t isize){
+  RBUF result = 0;
+  size_t i = 0;
+
+  if (flags & RBUF_POW2){
+    icap = rbRoundCap(icap);
   }
 
   if (icap == 0){
-    free(result);
+    return 0;
+  }
+
+  result = (RBUF)malloc(sizeof(struct _rbuf_));
+  if (result == 0){
     return 0;
   }
 
@@ -31,10 +103,26 @@ RBUF rbufInit(size_t icap){
     return 0;
   }
 
+  result->storage = 0;
+  result->isize = isize;
+  result->reserved = 0;
+  if (isize != 0){
+    result->storage = (uint8_t*)calloc(icap, RBUF_ITEM_ALIGN(isize));
+    if (result->storage == 0){
+      free(result->data);
+      free(result);
+      return 0;
+    }
+    for (i = 0; i < icap; ++i){
+      result->data[i].data = result->storage + i*RBUF_ITEM_ALIGN(isize);
+    }
+  }
+
   result->cap = icap;
-  result->start = 0;
+  result->mask = icap - 1;
+  result->pow2 = (icap & (icap - 1)) == 0;
+  result->front = 0;
   result->end = 0;
-  result->size = 0;
   result->clean = 0;
   return result;
 }
@@ -43,14 +131,15 @@ void rbufReset(RBUF rb){
   if (rb == 0){
     return;
   }
-  rb->start = 0;
+  rb->front = 0;
   rb->end = 0;
-  rb->size = 0;
+  rb->reserved = 0;
 }
 
 void rbufCleanup(RBUF* rbuf){
   if (rbuf != 0){
     if (*rbuf != 0){
+      free((*rbuf)->storage);
       free((*rbuf)->data);
       free(*rbuf);
       *rbuf = 0;
@@ -60,7 +149,7 @@ void rbufCleanup(RBUF* rbuf){
 
 size_t rbufSize(const RBUF rbuf){
   if (rbuf != 0){
-    return rbuf->size;
+    return (size_t)(rbuf->end - rbuf->front);
   }
   return 0;
 }
@@ -74,20 +163,30 @@ size_t rbufCap(const RBUF rbuf){
 
 RBITEM rbufFront(const RBUF rbuf){
   if (rbuf != 0){
-    if (rbuf->size == 0){
+    if (rbuf->end == rbuf->front){
       return 0;
     }
-    return rbuf->data + rbuf->start;
+    return rbuf->data + rbufSlot(rbuf, rbuf->front);
   }
   return 0;
 }
 
 RBITEM rbufBack(const RBUF rbuf){
   if (rbuf != 0){
-    if (rbuf->size == 0){
+    if (rbuf->end == rbuf->front){
       return 0;
     }
-    return rbuf->data + rbuf->end;
+    return rbuf->data + rbufSlot(rbuf, rbuf->end - 1);
+  }
+  return 0;
+}
+
+RBITEM rbufAt(const RBUF rbuf, size_t index){
+  if (rbuf != 0){
+    if (index >= rbuf->end - rbuf->front){
+      return 0;
+    }
+    return rbuf->data + rbufSlot(rbuf, rbuf->front + index);
   }
   return 0;
 }
@@ -95,27 +194,75 @@ RBITEM rbufBack(const RBUF rbuf){
 RBITEM rbufPushBack(RBUF rbuf, void* data){
   RBITEM item = 0;
 
-  if (rbuf == 0){
+  if ((rbuf == 0) || (rbufReserve(rbuf) == 0)){
     return 0;
   }
 
-  if (rbuf->size != 0){ // Special case for zero-sized array, when end and start are equal
-    rbuf->end = (rbuf->end + 1) % rbuf->cap;
+  item = rbuf->data + rbufSlot(rbuf, rbuf->end);
+  if (rbuf->storage == 0){
+    item->data = data;
+  }else if (data != 0){
+    memcpy(item->data, data, rbuf->isize);
+  }else{
+    memset(item->data, 0, rbuf->isize);
   }
+  rbufCommit(rbuf);
+  return item;
+}
 
-  if (rbuf->size == rbuf->cap){
-    rbuf->start = (rbuf->start+1)%rbuf->cap;
-  }else{
-    ++rbuf->size;
+void* rbufReserve(RBUF rbuf){
+  RBITEM item = 0;
+  int dropped = 0;
+
+  if ((rbuf == 0) || rbuf->reserved){
+    return 0;
   }
 
-  item = rbufBack(rbuf);
-  if (rbuf->clean != 0) {
-    rbuf->clean(item->data);
-    item->data = 0;
+  if (rbuf->end - rbuf->front == rbuf->cap){
+    ++rbuf->front;
+    dropped = 1;
   }
-  item->data = data;
-  return item;
+
+  /*
+   * Pointer slot is cleaned every time it is reused, item storage only
+   * when its element is dropped, popped items are not owned by ring.
+   */
+  item = rbuf->data + rbufSlot(rbuf, rbuf->end);
+  if (rbuf->clean != 0){
+    if (rbuf->storage == 0){
+      rbuf->clean(item->data);
+      item->data = 0;
+    }else if (dropped){
+      rbuf->clean(item->data);
+    }
+  }
+
+  rbuf->reserved = 1;
+  return rbufItemMemory(rbuf, item);
+}
+
+int rbufCommit(RBUF rbuf){
+  if ((rbuf == 0) || (rbuf->reserved == 0)){
+    return -1;
+  }
+  ++rbuf->end;
+  rbuf->reserved = 0;
+  return 0;
+}
+
+void* rbufPeek(const RBUF rbuf){
+  if ((rbuf == 0) || (rbuf->end == rbuf->front)){
+    return 0;
+  }
+  return rbufItemMemory(rbuf, rbuf->data + rbufSlot(rbuf, rbuf->front));
+}
+
+int rbufRelease(RBUF rbuf){
+  if ((rbuf == 0) || (rbuf->end == rbuf->front)){
+    return -1;
+  }
+  ++rbuf->front;
+  return 0;
 }
 
 void* rbufPopFront(RBUF rbuf){
@@ -124,16 +271,119 @@ void* rbufPopFront(RBUF rbuf){
     return 0;
   }
 
-  if (rbuf->size == 0){
+  if (rbuf->end == rbuf->front){
     return 0;
   }
 
-  item = rbufFront(rbuf);
-  rbuf->start = (rbuf->start+1)%rbuf->cap;
-  --rbuf->size;
+  item = rbuf->data + rbufSlot(rbuf, rbuf->front++);
   return item->data;
 }
 
+/**
+ * Split n slots starting at seq into contiguous runs.
+ *
+ * @return number of runs
+ */
+static int rbufSegments(const RBUF rbuf, uint64_t seq, size_t n, rbufSpan* spans){
+  size_t first = 0;
+
+  if (n == 0){
+    return 0;
+  }
+  first = rbufSlot(rbuf, seq);
+  spans[0].data = (void**)(rbuf->data + first);
+  if (n <= rbuf->cap - first){
+    spans[0].count = n;
+    return 1;
+  }
+  spans[0].count = rbuf->cap - first;
+  spans[1].data = (void**)rbuf->data;
+  spans[1].count = n - spans[0].count;
+  return 2;
+}
+
+size_t rbufPushBackN(RBUF rbuf, void* const* data, size_t n){
+  rbufSpan spans[2];
+  size_t total = n;
+  size_t size = 0;
+  size_t k = 0;
+  int count = 0;
+  int i = 0;
+
+  if ((rbuf == 0) || rbuf->reserved || ((data == 0) && (n != 0))){
+    return 0;
+  }
+
+  if ((rbuf->clean != 0) || (rbuf->storage != 0)){
+    for (k = 0; k < n; ++k){
+      rbufPushBack(rbuf, data[k]);
+    }
+    return n;
+  }
+
+  if (n > rbuf->cap){ // Leading elements are overwritten by trailing ones anyway
+    rbuf->end += n - rbuf->cap;
+    data += n - rbuf->cap;
+    n = rbuf->cap;
+  }
+
+  size = (size_t)(rbuf->end - rbuf->front);
+  if (size > rbuf->cap - n){
+    rbuf->front = rbuf->end + n - rbuf->cap;
+  }
+
+  count = rbufSegments(rbuf, rbuf->end, n, spans);
+  for (i = 0; i < count; ++i){
+    memcpy(spans[i].data, data, spans[i].count*sizeof(void*));
+    data += spans[i].count;
+  }
+  rbuf->end += n;
+  return total;
+}
+
+size_t rbufPopFrontN(RBUF rbuf, void** data, size_t n){
+  rbufSpan spans[2];
+  size_t size = 0;
+  int count = 0;
+  int i = 0;
+
+  if (rbuf == 0){
+    return 0;
+  }
+
+  size = (size_t)(rbuf->end - rbuf->front);
+  if (n > size){
+    n = size;
+  }
+
+  if (data != 0){
+    count = rbufSegments(rbuf, rbuf->front, n, spans);
+    for (i = 0; i < count; ++i){
+      memcpy(data, spans[i].data, spans[i].count*sizeof(void*));
+      data += spans[i].count;
+    }
+  }
+  rbuf->front += n;
+  return n;
+}
+
+int rbufSpans(const RBUF rbuf, size_t index, size_t n, rbufSpan* spans){
+  size_t size = 0;
+
+  if ((rbuf == 0) || (spans == 0)){
+    return 0;
+  }
+
+  size = (size_t)(rbuf->end - rbuf->front);
+  if (index >= size){
+    return 0;
+  }
+  if (n > size - index){
+    n = size - index;
+  }
+  return rbufSegments(rbuf, rbuf->front + index, n, spans);
+}
+
 void* rbufValue(const RBITEM item){
   if (item == 0){
     return 0;
@@ -149,54 +399,42 @@ int rbufSetValue(RBITEM item, void* value) {
   return 0;
 }
 
-static int rbufIndexInside(const RBUF rbuf, size_t index){
-  if (rbuf == 0){
-    return -1;
-  }
-  if (rbuf->size == 0){
-    return 0;
-  }
-  if (rbuf->start < rbuf->end){
-    return (index >= rbuf->start) && (index <= rbuf->end);
-  }
-  return (index >= rbuf->start) || (index <= rbuf->end);
-}
-
 RBITEM rbufNext(const RBUF rbuf, RBITEM item){
-  int ind = 0;
-  int nxt = 0;
+  size_t index = 0;
 
   if ((rbuf == 0)||(item == 0)){
     return 0;
   }
 
-  ind = item - rbuf->data;
-  if ((rbufIndexInside(rbuf, ind) == 0)||(ind == rbuf->end)){
+  if (rbufOffset(rbuf, item) + 1 >= rbufSize(rbuf)){
     return 0;
   }
 
-  nxt = (ind + 1)%rbuf->cap;
-  return rbuf->data + nxt;
-}
-
-static int modulo(int x, int d){
-  return (x%d + d)%d;
+  index = (size_t)(item - rbuf->data) + 1;
+  if (index == rbuf->cap){
+    index = 0;
+  }
+  return rbuf->data + index;
 }
 
 RBITEM rbufPrev(const RBUF rbuf, RBITEM item){
-  int ind = 0;
-  int prv = 0;
+  size_t index = 0;
+  size_t offset = 0;
 
   if ((rbuf == 0)||(item == 0)){
     return 0;
   }
 
-  ind = item - rbuf->data;
-  if ((rbufIndexInside(rbuf, ind) == 0)||(ind == rbuf->start)){
+  offset = rbufOffset(rbuf, item);
+  if ((offset == 0) || (offset >= rbufSize(rbuf))){
     return 0;
   }
-  prv = modulo(ind - 1, rbuf->cap);
-  return rbuf->data + prv;
+
+  index = (size_t)(item - rbuf->data);
+  if (index == 0){
+    index = rbuf->cap;
+  }
+  return rbuf->data + index - 1;
 }
 
 rbufCleanupFunc rbufSetCleanupFunc(RBUF rbuf, rbufCleanupFunc func) {
@@ -0,0 +1,398 @@
+#ifdef __linux__
+#define _GNU_SOURCE
+#include <sys/mman.h>
+#include <unistd.h>
+#define RBB_HAS_MIRROR
+#endif
+
+#include <string.h>
+
+#include <rbbytes.h>
+#include "rbpriv.h"
+
+/**
+ * Size of record header, keeps payloads 8 bytes aligned.
+ */
+#define RBB_HEADER (8)
+
+/**
+ * Smallest capacity.
+ */
+#define RBB_MIN_CAP (16)
+
+/**
+ * Header length marking unused tail of storage, next record starts at
+ * storage beginning.
+ */
+#define RBB_PADDING (UINT32_MAX)
+
+/**
+ * Round record size to header alignment.
+ */
+#define RBB_ALIGN(n) (((n) + RBB_HEADER - 1) & ~((size_t)RBB_HEADER - 1))
+
+/**
+ * Internal structure of byte ring buffer.
+ *
+ * Head and tail are monotonic byte counters. Record is stored as
+ * uint32_t length followed by payload, padded to RBB_HEADER bytes.
+ */
+struct _rbbytes_ {
+  uint8_t* data; /**< Storage */
+  size_t mask; /**< Capacity - 1, capacity is power of two */
+  int mirror; /**< Storage is mapped twice back to back */
+  uint64_t head; /**< Position of first stored byte */
+  uint64_t tail; /**< Position after last stored byte */
+  uint64_t rsvPos; /**< Position of reserved record header */
+  size_t rsvSize; /**< Reserved bytes or record size */
+  int reserved; /**< Space is reserved and not committed yet */
+};
+
+/**
+ * Get number of contiguous bytes starting at pos.
+ *
+ * Mirrored storage continues past its end with its own beginning.
+ */
+static INLINE size_t rbbTillEnd(const RBBYTES rb, uint64_t pos){
+  if (rb->mirror){
+    return rb->mask + 1;
+  }
+  return rb->mask + 1 - (size_t)(pos & rb->mask);
+}
+
+/**
+ * Map same memory file twice in a row.
+ *
+ * @return mapping of 2*cap bytes or zero on error
+ */
+static uint8_t* rbbMapMirror(size_t cap){
+#ifdef RBB_HAS_MIRROR
+  uint8_t* result = 0;
+  int fd = memfd_create("rbbytes", MFD_CLOEXEC);
+
+  if (fd < 0){
+    return 0;
+  }
+
+  if (ftruncate(fd, (off_t) cap) != 0){
+    close(fd);
+    return 0;
+  }
+
+  // Reserve address range first, so both halves are adjacent
+  result = (uint8_t*)mmap(0, 2*cap, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (result == MAP_FAILED){
+    close(fd);
+    return 0;
+  }
+
+  if ((mmap(result, cap, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED)
+    || (mmap(result + cap, cap, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED)){
+    munmap(result, 2*cap);
+    close(fd);
+    return 0;
+  }
+
+  close(fd); // Mappings keep memory file alive
+  return result;
+#else
+  (void) cap;
+  return 0;
+#endif
+}
+
+static INLINE uint32_t rbbHeader(const RBBYTES rb, uint64_t pos){
+  uint32_t result = 0;
+  memcpy(&result, rb->data + (pos & rb->mask), sizeof(uint32_t));
+  return result;
+}
+
+static INLINE void rbbSetHeader(RBBYTES rb, uint64_t pos, uint32_t len){
+  memcpy(rb->data + (pos & rb->mask), &len, sizeof(uint32_t));
+}
+
+/**
+ * Get position of first record header, skipping padding.
+ */
+static INLINE uint64_t rbbRecordFirst(const RBBYTES rb){
+  if (rbbHeader(rb, rb->head) == RBB_PADDING){
+    return rb->head + rbbTillEnd(rb, rb->head);
+  }
+  return rb->head;
+}
+
+RBBYTES rbbInit(size_t icap){
+  return rbbInitEx(icap, RBB_DEFAULT);
+}
+
+RBBYTES rbbInitEx(size_t icap, uint32_t flags){
+  RBBYTES result = 0;
+  size_t cap = 0;
+
+  if (icap == 0){
+    return 0;
+  }
+
+  if (icap < RBB_MIN_CAP){
+    icap = RBB_MIN_CAP;
+  }
+#ifdef RBB_HAS_MIRROR
+  if ((flags & RBB_MIRROR) && (icap < (size_t) sysconf(_SC_PAGESIZE))){
+    icap = (size_t) sysconf(_SC_PAGESIZE);
+  }
+#endif
+
+  cap = rbRoundCap(icap);
+  if (cap == 0){
+    return 0;
+  }
+
+  result = (RBBYTES)calloc(1, sizeof(struct _rbbytes_));
+  if (result == 0){
+    return 0;
+  }
+
+  if (flags & RBB_MIRROR){
+    result->data = rbbMapMirror(cap);
+    result->mirror = 1;
+  }else{
+    result->data = (uint8_t*)aligned_alloc(RB_CACHE_LINE, (cap < RB_CACHE_LINE)?RB_CACHE_LINE:cap);
+  }
+  if (result->data == 0){
+    free(result);
+    return 0;
+  }
+  result->mask = cap - 1;
+  return result;
+}
+
+void rbbCleanup(RBBYTES* rb){
+  if ((rb != 0) && (*rb != 0)){
+#ifdef RBB_HAS_MIRROR
+    if ((*rb)->mirror){
+      munmap((*rb)->data, 2*((*rb)->mask + 1));
+    }else{
+      free((*rb)->data);
+    }
+#else
+    free((*rb)->data);
+#endif
+    free(*rb);
+    *rb = 0;
+  }
+}
+
+void rbbReset(RBBYTES rb){
+  if (rb == 0){
+    return;
+  }
+  rb->head = 0;
+  rb->tail = 0;
+  rb->reserved = 0;
+}
+
+size_t rbbCap(const RBBYTES rb){
+  if (rb == 0){
+    return 0;
+  }
+  return rb->mask + 1;
+}
+
+size_t rbbSize(const RBBYTES rb){
+  if (rb == 0){
+    return 0;
+  }
+  return (size_t)(rb->tail - rb->head);
+}
+
+void* rbbReserve(RBBYTES rb, size_t* n){
+  size_t avail = 0;
+  size_t tillEnd = 0;
+
+  if ((rb == 0) || (n == 0)){
+    return 0;
+  }
+
+  avail = rb->mask + 1 - (size_t)(rb->tail - rb->head);
+  tillEnd = rbbTillEnd(rb, rb->tail);
+  *n = (avail < tillEnd)?avail:tillEnd;
+  rb->rsvPos = rb->tail;
+  rb->rsvSize = *n;
+  rb->reserved = (*n != 0);
+  if (*n == 0){
+    return 0;
+  }
+  return rb->data + (rb->tail & rb->mask);
+}
+
+int rbbCommit(RBBYTES rb, size_t n){
+  if ((rb == 0) || (rb->reserved == 0) || (n > rb->rsvSize)){
+    return -1;
+  }
+  rb->tail += n;
+  rb->reserved = 0;
+  return 0;
+}
+
+const void* rbbPeek(const RBBYTES rb, size_t* n){
+  size_t size = 0;
+  size_t tillEnd = 0;
+
+  if ((rb == 0) || (n == 0)){
+    return 0;
+  }
+
+  size = (size_t)(rb->tail - rb->head);
+  tillEnd = rbbTillEnd(rb, rb->head);
+  *n = (size < tillEnd)?size:tillEnd;
+  if (*n == 0){
+    return 0;
+  }
+  return rb->data + (rb->head & rb->mask);
+}
+
+int rbbConsume(RBBYTES rb, size_t n){
+  if ((rb == 0) || (n > rb->tail - rb->head)){
+    return -1;
+  }
+  rb->head += n;
+  return 0;
+}
+
+size_t rbbWrite(RBBYTES rb, const void* data, size_t n){
+  const uint8_t* src = (const uint8_t*) data;
+  size_t result = 0;
+  size_t chunk = 0;
+  void* dst = 0;
+
+  if ((rb == 0) || ((data == 0) && (n != 0))){
+    return 0;
+  }
+
+  while ((result < n) && ((dst = rbbReserve(rb, &chunk)) != 0)){
+    if (chunk > n - result){
+      chunk = n - result;
+    }
+    memcpy(dst, src + result, chunk);
+    rbbCommit(rb, chunk);
+    result += chunk;
+  }
+  rb->reserved = 0;
+  return result;
+}
+
+size_t rbbRead(RBBYTES rb, void* data, size_t n){
+  uint8_t* dst = (uint8_t*) data;
+  size_t result = 0;
+  size_t chunk = 0;
+  const void* src = 0;
+
+  if ((rb == 0) || ((data == 0) && (n != 0))){
+    return 0;
+  }
+
+  while ((result < n) && ((src = rbbPeek(rb, &chunk)) != 0)){
+    if (chunk > n - result){
+      chunk = n - result;
+    }
+    memcpy(dst + result, src, chunk);
+    rb->head += chunk;
+    result += chunk;
+  }
+  return result;
+}
+
+void* rbbRecordReserve(RBBYTES rb, size_t n){
+  size_t need = 0;
+  size_t avail = 0;
+  size_t tillEnd = 0;
+  uint64_t pos = 0;
+
+  if ((rb == 0) || (n >= RBB_PADDING)){
+    return 0;
+  }
+
+  need = RBB_HEADER + RBB_ALIGN(n);
+  if (need > rb->mask + 1){
+    return 0;
+  }
+
+  tillEnd = rbbTillEnd(rb, rb->tail);
+  if ((need > tillEnd) && (rb->head == rb->tail)){ // Empty ring restarts from storage beginning
+    rb->head = rb->tail = rb->tail + tillEnd;
+    tillEnd = rb->mask + 1;
+  }
+
+  pos = rb->tail;
+  avail = rb->mask + 1 - (size_t)(rb->tail - rb->head);
+  if (need > tillEnd){
+    if (avail < tillEnd + need){
+      return 0;
+    }
+    pos += tillEnd;
+  }else if (avail < need){
+    return 0;
+  }
+
+  rb->rsvPos = pos;
+  rb->rsvSize = n;
+  rb->reserved = 1;
+  return rb->data + (pos & rb->mask) + RBB_HEADER;
+}
+
+int rbbRecordCommit(RBBYTES rb, size_t n){
+  if ((rb == 0) || (rb->reserved == 0) || (n > rb->rsvSize)){
+    return -1;
+  }
+
+  if (rb->rsvPos != rb->tail){
+    rbbSetHeader(rb, rb->tail, RBB_PADDING);
+  }
+  rbbSetHeader(rb, rb->rsvPos, (uint32_t) n);
+  rb->tail = rb->rsvPos + RBB_HEADER + RBB_ALIGN(n);
+  rb->reserved = 0;
+  return 0;
+}
+
+const void* rbbRecordPeek(const RBBYTES rb, size_t* n){
+  uint64_t pos = 0;
+
+  if ((rb == 0) || (rb->head == rb->tail)){
+    return 0;
+  }
+
+  pos = rbbRecordFirst(rb);
+  if (n != 0){
+    *n = rbbHeader(rb, pos);
+  }
+  return rb->data + (pos & rb->mask) + RBB_HEADER;
+}
+
+int rbbRecordConsume(RBBYTES rb){
+  uint64_t pos = 0;
+
+  if ((rb == 0) || (rb->head == rb->tail)){
+    return -1;
+  }
+
+  pos = rbbRecordFirst(rb);
+  rb->head = pos + RBB_HEADER + RBB_ALIGN(rbbHeader(rb, pos));
+  return 0;
+}
+
+int rbbRecordPush(RBBYTES rb, const void* data, size_t n){
+  void* dst = 0;
+
+  if ((data == 0) && (n != 0)){
+    return -1;
+  }
+
+  dst = rbbRecordReserve(rb, n);
+  if (dst == 0){
+    return -1;
+  }
+  if (n != 0){
+    memcpy(dst, data, n);
+  }
+  return rbbRecordCommit(rb, n);
+}
@@ -0,0 +1,320 @@
+#include <stdatomic.h>
+#include <pthread.h>
+#include <sched.h>
+
+#include <rbcast.h>
+#include "rbpriv.h"
+
+/**
+ * Maximum number of readers.
+ */
+#define RBCAST_MAX_READERS (64)
+
+/**
+ * Number of failed attempts before blocking call starts to yield.
+ */
+#define RBCAST_SPIN (64)
+
+/**
+ * Ring slot.
+ *
+ * Slot holds item with sequence number seq, when published == seq + 1.
+ * Producer writes slot only after every reader passed previous item in
+ * it, so published never runs ahead of readers.
+ */
+typedef struct _rbcast_slot_ {
+  _Atomic(uint64_t) published; /**< Published sequence number + 1, zero if none */
+  void* data; /**< Item */
+} rbcastSlot;
+
+/**
+ * Registered reader.
+ *
+ * Cursor is written by owning thread only and read by producers and
+ * dependent readers, so it lives on its own cache line.
+ */
+struct _rbcast_reader_ {
+  _Alignas(RB_CACHE_LINE) _Atomic(uint64_t) cursor; /**< Next sequence number to read */
+  RBCAST rb; /**< Owner */
+  RBCREADER* deps; /**< Readers, which must pass item first */
+  size_t ndeps; /**< Number of dependencies */
+  uint64_t limit; /**< Last seen minimal dependency cursor */
+};
+
+/**
+ * Internal structure of broadcast ring.
+ */
+struct _rbcast_ {
+  uint64_t mask; /**< Capacity - 1, capacity is power of two */
+  rbcastSlot* slots; /**< Slots */
+  pthread_mutex_t lock; /**< Serializes reader registration */
+  RBCREADER readers[RBCAST_MAX_READERS]; /**< Registered readers */
+  _Atomic(uint32_t) count; /**< Number of registered readers */
+  _Alignas(RB_CACHE_LINE) _Atomic(uint64_t) claim; /**< Next sequence number to claim */
+  _Atomic(uint64_t) gate; /**< Last seen minimal reader cursor */
+};
+
+/**
+ * Find slowest reader cursor.
+ *
+ * @return minimal cursor, or limit, if there are no readers
+ */
+static uint64_t rbcastMinCursor(RBCREADER const* readers, size_t count, uint64_t limit){
+  uint64_t result = limit;
+  uint64_t cursor = 0;
+  size_t i = 0;
+
+  for (i = 0; i < count; ++i){
+    // Acquire pairs with reader release, so slot is not read anymore
+    cursor = atomic_load_explicit(&readers[i]->cursor, memory_order_acquire);
+    if (cursor < result){
+      result = cursor;
+    }
+  }
+  return result;
+}
+
+RBCAST rbcastInit(size_t icap){
+  RBCAST result = 0;
+  size_t cap = rbRoundCap(icap);
+
+  if (cap == 0){
+    return 0;
+  }
+
+  result = (RBCAST)aligned_alloc(RB_CACHE_LINE, sizeof(struct _rbcast_));
+  if (result == 0){
+    return 0;
+  }
+
+  result->slots = (rbcastSlot*)calloc(cap, sizeof(rbcastSlot));
+  if (result->slots == 0){
+    free(result);
+    return 0;
+  }
+
+  if (pthread_mutex_init(&result->lock, 0) != 0){
+    free(result->slots);
+    free(result);
+    return 0;
+  }
+
+  result->mask = cap - 1;
+  atomic_init(&result->count, 0);
+  atomic_init(&result->claim, 0);
+  atomic_init(&result->gate, 0);
+  return result;
+}
+
+void rbcastCleanup(RBCAST* rb){
+  uint32_t i = 0;
+
+  if ((rb != 0) && (*rb != 0)){
+    for (i = 0; i < atomic_load(&(*rb)->count); ++i){
+      free((*rb)->readers[i]->deps);
+      free((*rb)->readers[i]);
+    }
+    pthread_mutex_destroy(&(*rb)->lock);
+    free((*rb)->slots);
+    free(*rb);
+    *rb = 0;
+  }
+}
+
+size_t rbcastCap(const RBCAST rb){
+  if (rb == 0){
+    return 0;
+  }
+  return (size_t)(rb->mask + 1);
+}
+
+RBCREADER rbcastAttach(RBCAST rb, const RBCREADER* deps, size_t ndeps){
+  RBCREADER result = 0;
+  uint32_t count = 0;
+  size_t i = 0;
+
+  if ((rb == 0) || ((deps == 0) && (ndeps != 0))){
+    return 0;
+  }
+
+  for (i = 0; i < ndeps; ++i){
+    if ((deps[i] == 0) || (deps[i]->rb != rb)){
+      return 0;
+    }
+  }
+
+  result = (RBCREADER)aligned_alloc(RB_CACHE_LINE, sizeof(struct _rbcast_reader_));
+  if (result == 0){
+    return 0;
+  }
+
+  result->deps = 0;
+  if (ndeps != 0){
+    result->deps = (RBCREADER*)malloc(ndeps*sizeof(RBCREADER));
+    if (result->deps == 0){
+      free(result);
+      return 0;
+    }
+    for (i = 0; i < ndeps; ++i){
+      result->deps[i] = deps[i];
+    }
+  }
+  result->rb = rb;
+  result->ndeps = ndeps;
+
+  pthread_mutex_lock(&rb->lock);
+  count = atomic_load_explicit(&rb->count, memory_order_relaxed);
+  if (count == RBCAST_MAX_READERS){
+    pthread_mutex_unlock(&rb->lock);
+    free(result->deps);
+    free(result);
+    return 0;
+  }
+  result->limit = atomic_load_explicit(&rb->claim, memory_order_relaxed);
+  atomic_init(&result->cursor, result->limit);
+  rb->readers[count] = result;
+  // Release publishes reader to producers
+  atomic_store_explicit(&rb->count, count + 1, memory_order_release);
+  pthread_mutex_unlock(&rb->lock);
+  return result;
+}
+
+int rbcastTryClaim(RBCAST rb, uint64_t* seq){
+  uint64_t claim = 0;
+  uint64_t gate = 0;
+  uint32_t count = 0;
+
+  if ((rb == 0) || (seq == 0)){
+    return -1;
+  }
+
+  claim = atomic_load_explicit(&rb->claim, memory_order_relaxed);
+  for (;;){
+    gate = atomic_load_explicit(&rb->gate, memory_order_acquire);
+    if (claim - gate > rb->mask){
+      count = atomic_load_explicit(&rb->count, memory_order_acquire);
+      gate = rbcastMinCursor(rb->readers, count, claim);
+      atomic_store_explicit(&rb->gate, gate, memory_order_release);
+      if (claim - gate > rb->mask){
+        return -1;
+      }
+    }
+    // On failure claim receives actual value
+    if (atomic_compare_exchange_weak_explicit(&rb->claim, &claim, claim + 1,
+        memory_order_relaxed, memory_order_relaxed)){
+      *seq = claim;
+      return 0;
+    }
+  }
+}
+
+int rbcastClaim(RBCAST rb, uint64_t* seq){
+  uint32_t spin = 0;
+
+  if ((rb == 0) || (seq == 0)){
+    return -1;
+  }
+
+  while (rbcastTryClaim(rb, seq) != 0){
+    if (++spin >= RBCAST_SPIN){
+      sched_yield();
+    }
+  }
+  return 0;
+}
+
+int rbcastPublish(RBCAST rb, uint64_t seq, void* data){
+  rbcastSlot* slot = 0;
+
+  if ((rb == 0) || (seq >= atomic_load_explicit(&rb->claim, memory_order_relaxed))){
+    return -1;
+  }
+
+  /*
+   * Slot remembers its latest published number, so it tells repeated
+   * publish and number, which slot was reused by later lap, apart from
+   * valid claim up to a whole ring ahead of readers.
+   */
+  slot = rb->slots + (seq & rb->mask);
+  if (atomic_load_explicit(&slot->published, memory_order_relaxed) >= seq + 1){
+    return -1;
+  }
+  slot->data = data;
+  atomic_store_explicit(&slot->published, seq + 1, memory_order_release);
+  return 0;
+}
+
+int rbcastTryPush(RBCAST rb, void* data){
+  uint64_t seq = 0;
+
+  if (rbcastTryClaim(rb, &seq) != 0){
+    return -1;
+  }
+  return rbcastPublish(rb, seq, data);
+}
+
+int rbcastPush(RBCAST rb, void* data){
+  uint64_t seq = 0;
+
+  if (rbcastClaim(rb, &seq) != 0){
+    return -1;
+  }
+  return rbcastPublish(rb, seq, data);
+}
+
+size_t rbcastPoll(RBCREADER rd, void** data, size_t n){
+  rbcastSlot* slot = 0;
+  uint64_t cursor = 0;
+  size_t result = 0;
+
+  if ((rd == 0) || ((data == 0) && (n != 0))){
+    return 0;
+  }
+
+  cursor = atomic_load_explicit(&rd->cursor, memory_order_relaxed);
+  if ((rd->ndeps != 0) && (rd->limit < cursor + n)){
+    rd->limit = rbcastMinCursor(rd->deps, rd->ndeps, UINT64_MAX);
+  }
+
+  for (result = 0; result < n; ++result){
+    if ((rd->ndeps != 0) && (cursor + result >= rd->limit)){
+      break;
+    }
+    slot = rd->rb->slots + ((cursor + result) & rd->rb->mask);
+    if (atomic_load_explicit(&slot->published, memory_order_acquire) != cursor + result + 1){
+      break;
+    }
+    data[result] = slot->data;
+  }
+
+  if (result != 0){
+    atomic_store_explicit(&rd->cursor, cursor + result, memory_order_release);
+  }
+  return result;
+}
+
+int rbcastRead(RBCREADER rd, void** data){
+  void* value = 0;
+  uint32_t spin = 0;
+
+  if (rd == 0){
+    return -1;
+  }
+
+  while (rbcastPoll(rd, &value, 1) == 0){
+    if (++spin >= RBCAST_SPIN){
+      sched_yield();
+    }
+  }
+  if (data != 0){
+    *data = value;
+  }
+  return 0;
+}
+
+uint64_t rbcastCursor(const RBCREADER rd){
+  if (rd == 0){
+    return 0;
+  }
+  return atomic_load_explicit(&rd->cursor, memory_order_acquire);
+}
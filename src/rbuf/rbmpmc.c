@@ -0,0 +1,183 @@
+#include <stdatomic.h>
+#include <sched.h>
+
+#include <rbmpmc.h>
+#include "rbpriv.h"
+
+/**
+ * Number of failed attempts before blocking call starts to yield.
+ */
+#define RBMPMC_SPIN (64)
+
+/**
+ * Queue slot.
+ *
+ * Slot at position pos is free for producer when seq == pos, and holds
+ * item for consumer when seq == pos + 1. Consumer frees slot for next
+ * lap by storing pos + cap.
+ */
+typedef struct _rbmpmc_slot_ {
+  _Atomic(size_t) seq; /**< Slot sequence number */
+  void* data; /**< Stored item */
+} rbmpmcSlot;
+
+/**
+ * Internal structure of MPMC queue.
+ */
+struct _rbmpmc_ {
+  size_t mask; /**< Capacity - 1, capacity is power of two */
+  rbmpmcSlot* slots; /**< Slots */
+  _Alignas(RB_CACHE_LINE) _Atomic(size_t) tail; /**< Next position to claim by producers */
+  _Alignas(RB_CACHE_LINE) _Atomic(size_t) head; /**< Next position to claim by consumers */
+};
+
+RBMPMC rbmpmcInit(size_t icap){
+  RBMPMC result = 0;
+  size_t cap = rbRoundCap((icap < 2)?(icap*2):icap);
+  size_t i = 0;
+
+  if (cap == 0){
+    return 0;
+  }
+
+  result = (RBMPMC)aligned_alloc(RB_CACHE_LINE, sizeof(struct _rbmpmc_));
+  if (result == 0){
+    return 0;
+  }
+
+  result->slots = (rbmpmcSlot*)calloc(cap, sizeof(rbmpmcSlot));
+  if (result->slots == 0){
+    free(result);
+    return 0;
+  }
+
+  for (i = 0; i < cap; ++i){
+    atomic_init(&result->slots[i].seq, i);
+  }
+  result->mask = cap - 1;
+  atomic_init(&result->tail, 0);
+  atomic_init(&result->head, 0);
+  return result;
+}
+
+void rbmpmcCleanup(RBMPMC* rb){
+  if ((rb != 0) && (*rb != 0)){
+    free((*rb)->slots);
+    free(*rb);
+    *rb = 0;
+  }
+}
+
+size_t rbmpmcCap(const RBMPMC rb){
+  if (rb == 0){
+    return 0;
+  }
+  return rb->mask + 1;
+}
+
+size_t rbmpmcSize(const RBMPMC rb){
+  size_t head = 0;
+  size_t tail = 0;
+
+  if (rb == 0){
+    return 0;
+  }
+  head = atomic_load_explicit(&rb->head, memory_order_relaxed);
+  tail = atomic_load_explicit(&rb->tail, memory_order_relaxed);
+  return (tail > head)?(tail - head):0;
+}
+
+int rbmpmcTryPush(RBMPMC rb, void* data){
+  rbmpmcSlot* slot = 0;
+  size_t pos = 0;
+  size_t seq = 0;
+
+  if (rb == 0){
+    return -1;
+  }
+
+  pos = atomic_load_explicit(&rb->tail, memory_order_relaxed);
+  for (;;){
+    slot = rb->slots + (pos & rb->mask);
+    seq = atomic_load_explicit(&slot->seq, memory_order_acquire);
+    if (seq == pos){
+      // On failure pos receives actual tail
+      if (atomic_compare_exchange_weak_explicit(&rb->tail, &pos, pos + 1,
+          memory_order_relaxed, memory_order_relaxed)){
+        break;
+      }
+    }else if ((intptr_t)(seq - pos) < 0){
+      // Slot still holds item of previous lap
+      return -1;
+    }else{
+      pos = atomic_load_explicit(&rb->tail, memory_order_relaxed);
+    }
+  }
+
+  slot->data = data;
+  atomic_store_explicit(&slot->seq, pos + 1, memory_order_release);
+  return 0;
+}
+
+int rbmpmcTryPop(RBMPMC rb, void** data){
+  rbmpmcSlot* slot = 0;
+  size_t pos = 0;
+  size_t seq = 0;
+
+  if (rb == 0){
+    return -1;
+  }
+
+  pos = atomic_load_explicit(&rb->head, memory_order_relaxed);
+  for (;;){
+    slot = rb->slots + (pos & rb->mask);
+    seq = atomic_load_explicit(&slot->seq, memory_order_acquire);
+    if (seq == pos + 1){
+      if (atomic_compare_exchange_weak_explicit(&rb->head, &pos, pos + 1,
+          memory_order_relaxed, memory_order_relaxed)){
+        break;
+      }
+    }else if ((intptr_t)(seq - (pos + 1)) < 0){
+      // Slot is not written yet
+      return -1;
+    }else{
+      pos = atomic_load_explicit(&rb->head, memory_order_relaxed);
+    }
+  }
+
+  if (data != 0){
+    *data = slot->data;
+  }
+  atomic_store_explicit(&slot->seq, pos + rb->mask + 1, memory_order_release);
+  return 0;
+}
+
+int rbmpmcPush(RBMPMC rb, void* data){
+  uint32_t spin = 0;
+
+  if (rb == 0){
+    return -1;
+  }
+
+  while (rbmpmcTryPush(rb, data) != 0){
+    if (++spin >= RBMPMC_SPIN){
+      sched_yield();
+    }
+  }
+  return 0;
+}
+
+int rbmpmcPop(RBMPMC rb, void** data){
+  uint32_t spin = 0;
+
+  if (rb == 0){
+    return -1;
+  }
+
+  while (rbmpmcTryPop(rb, data) != 0){
+    if (++spin >= RBMPMC_SPIN){
+      sched_yield();
+    }
+  }
+  return 0;
+}
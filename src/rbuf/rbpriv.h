@@ -0,0 +1,47 @@
+/**
+ * @file rbpriv.h
+ * @author masscry
+ *
+ * Private helpers shared by ring buffer variants.
+ *
+ */
+
+#ifndef __RBUF_PRIVATE_HEADER__
+#define __RBUF_PRIVATE_HEADER__
+
+#include <stdlib.h>
+#include <stdint.h>
+
+#ifdef _MSC_VER
+#define INLINE
+#else
+#define INLINE inline
+#endif
+
+/**
+ * Size of cache line, indexes written by different threads never share one.
+ */
+#define RB_CACHE_LINE (64)
+
+/**
+ * Largest supported ring capacity.
+ */
+#define RB_MAX_CAP (((size_t)1) << (sizeof(size_t)*8 - 2))
+
+/**
+ * Round capacity up to power of two.
+ *
+ * @return rounded capacity or zero if it is zero or too big
+ */
+static INLINE size_t rbRoundCap(size_t icap){
+  size_t cap = 1;
+  if ((icap == 0) || (icap > RB_MAX_CAP)){
+    return 0;
+  }
+  while (cap < icap){
+    cap <<= 1;
+  }
+  return cap;
+}
+
+#endif /* __RBUF_PRIVATE_HEADER__ */
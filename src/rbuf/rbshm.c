@@ -0,0 +1,448 @@
+#ifdef __linux__
+#define _GNU_SOURCE
+#define RBSHM_HAS_MEMFD
+#endif
+
+#include <stdatomic.h>
+#include <string.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#define RBSHM_HAS_SHM
+#endif
+
+#include <rbshm.h>
+#include "rbpriv.h"
+
+/**
+ * Shared memory object signature.
+ */
+#define RBSHM_MAGIC (0x4d485352u)
+
+/**
+ * Shared memory layout version.
+ */
+#define RBSHM_VERSION (1)
+
+/**
+ * Round size to slot alignment.
+ */
+#define RBSHM_ALIGN(n) (((n) + 7) & ~((size_t)7))
+
+/**
+ * Shared memory header, followed by slots.
+ *
+ * Contains no pointers, only sizes and indexes. Magic is stored last
+ * by creator, so process, which attached too early, sees invalid ring.
+ */
+typedef struct _rbshm_header_ {
+  _Atomic(uint32_t) magic; /**< RBSHM_MAGIC, when ring is ready */
+  uint32_t version; /**< RBSHM_VERSION */
+  uint64_t cap; /**< Capacity, power of two */
+  uint64_t isize; /**< Maximum record size */
+  uint64_t stride; /**< Distance between slots */
+  uint64_t bytes; /**< Whole object size */
+  _Alignas(RB_CACHE_LINE) _Atomic(uint64_t) tail; /**< Next position to claim by producers */
+  _Alignas(RB_CACHE_LINE) _Atomic(uint64_t) head; /**< Next position to claim by consumers */
+} rbshmHeader;
+
+/**
+ * Shared memory slot, record follows it.
+ *
+ * Slot at position pos is free for producer when seq == pos, and holds
+ * record for consumer when seq == pos + 1.
+ */
+typedef struct _rbshm_slot_ {
+  _Atomic(uint64_t) seq; /**< Slot sequence number */
+  uint64_t size; /**< Record size */
+} rbshmSlot;
+
+/**
+ * Process local handle.
+ *
+ * Layout values are checked once and copied here, so peer writing to
+ * shared header can not redirect slot addressing or record copies.
+ */
+struct _rbshm_ {
+  rbshmHeader* head; /**< Mapped object */
+  uint8_t* slots; /**< First slot */
+  uint64_t mask; /**< Capacity - 1 */
+  size_t isize; /**< Maximum record size */
+  size_t stride; /**< Distance between slots */
+  size_t bytes; /**< Mapping size */
+  int fd; /**< Shared memory object */
+};
+
+#if ATOMIC_LLONG_LOCK_FREE != 2
+#error "Shared memory ring needs lock-free 64-bit atomics"
+#endif
+
+static INLINE rbshmSlot* rbshmSlotAt(const RBSHM rb, uint64_t pos){
+  return (rbshmSlot*)(rb->slots + (pos & rb->mask)*rb->stride);
+}
+
+#ifdef RBSHM_HAS_SHM
+
+/**
+ * Map shared memory object and build handle.
+ *
+ * @return handle or zero on error, descriptor is closed on error
+ */
+static RBSHM rbshmMap(int fd, size_t bytes){
+  RBSHM result = (RBSHM)calloc(1, sizeof(struct _rbshm_));
+  void* map = 0;
+
+  if (result == 0){
+    close(fd);
+    return 0;
+  }
+
+  map = mmap(0, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (map == MAP_FAILED){
+    free(result);
+    close(fd);
+    return 0;
+  }
+
+  result->head = (rbshmHeader*) map;
+  result->slots = (uint8_t*) map + sizeof(rbshmHeader);
+  result->bytes = bytes;
+  result->fd = fd;
+  return result;
+}
+
+#endif /* RBSHM_HAS_SHM */
+
+RBSHM rbshmCreate(const char* name, size_t icap, size_t isize){
+#ifdef RBSHM_HAS_SHM
+  RBSHM result = 0;
+  size_t cap = rbRoundCap((icap < 2)?(icap*2):icap);
+  size_t stride = sizeof(rbshmSlot) + RBSHM_ALIGN(isize);
+  size_t bytes = 0;
+  size_t i = 0;
+  int fd = -1;
+
+  if ((cap == 0) || (isize == 0) || (stride < isize) || (cap > (SIZE_MAX - sizeof(rbshmHeader))/stride)){
+    return 0;
+  }
+  bytes = sizeof(rbshmHeader) + cap*stride;
+
+  if (name != 0){
+    fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+  }else{
+#ifdef RBSHM_HAS_MEMFD
+    fd = memfd_create("rbshm", MFD_CLOEXEC);
+#endif
+  }
+  if (fd < 0){
+    return 0;
+  }
+
+  if (ftruncate(fd, (off_t) bytes) != 0){
+    close(fd);
+    if (name != 0){
+      shm_unlink(name);
+    }
+    return 0;
+  }
+
+  result = rbshmMap(fd, bytes);
+  if (result == 0){
+    if (name != 0){
+      shm_unlink(name);
+    }
+    return 0;
+  }
+
+  result->mask = cap - 1;
+  result->isize = isize;
+  result->stride = stride;
+  result->head->version = RBSHM_VERSION;
+  result->head->cap = cap;
+  result->head->isize = isize;
+  result->head->stride = stride;
+  result->head->bytes = bytes;
+  atomic_init(&result->head->tail, 0);
+  atomic_init(&result->head->head, 0);
+  for (i = 0; i < cap; ++i){
+    atomic_init(&rbshmSlotAt(result, i)->seq, i);
+  }
+  atomic_store_explicit(&result->head->magic, RBSHM_MAGIC, memory_order_release);
+  return result;
+#else
+  (void) name;
+  (void) icap;
+  (void) isize;
+  return 0;
+#endif
+}
+
+RBSHM rbshmOpen(const char* name){
+#ifdef RBSHM_HAS_SHM
+  RBSHM result = 0;
+  int fd = -1;
+
+  if (name == 0){
+    return 0;
+  }
+
+  fd = shm_open(name, O_RDWR, 0);
+  if (fd < 0){
+    return 0;
+  }
+  result = rbshmOpenFd(fd);
+  close(fd);
+  return result;
+#else
+  (void) name;
+  return 0;
+#endif
+}
+
+RBSHM rbshmOpenFd(int fd){
+#ifdef RBSHM_HAS_SHM
+  const volatile rbshmHeader* head = 0;
+  RBSHM result = 0;
+  struct stat info;
+  uint64_t cap = 0;
+  uint64_t isize = 0;
+  uint64_t stride = 0;
+  uint64_t bytes = 0;
+
+  if ((fd < 0) || (fstat(fd, &info) != 0) || ((size_t) info.st_size < sizeof(rbshmHeader))){
+    return 0;
+  }
+
+  fd = dup(fd);
+  if (fd < 0){
+    return 0;
+  }
+
+  result = rbshmMap(fd, (size_t) info.st_size);
+  if (result == 0){
+    return 0;
+  }
+
+  /* Every field is read once, checked values are the ones kept */
+  head = result->head;
+  if ((atomic_load_explicit(&result->head->magic, memory_order_acquire) != RBSHM_MAGIC)
+    || (head->version != RBSHM_VERSION)){
+    rbshmCleanup(&result);
+    return 0;
+  }
+  cap = head->cap;
+  isize = head->isize;
+  stride = head->stride;
+  bytes = head->bytes;
+
+  if ((bytes != (uint64_t) info.st_size)
+    || (cap < 2) || ((cap & (cap - 1)) != 0)
+    || (isize == 0) || (isize >= bytes)
+    || (stride != sizeof(rbshmSlot) + RBSHM_ALIGN(isize))
+    || (cap > (bytes - sizeof(rbshmHeader))/stride)
+    || (bytes != sizeof(rbshmHeader) + cap*stride)){
+    rbshmCleanup(&result);
+    return 0;
+  }
+
+  result->mask = cap - 1;
+  result->isize = (size_t) isize;
+  result->stride = (size_t) stride;
+  return result;
+#else
+  (void) fd;
+  return 0;
+#endif
+}
+
+void rbshmCleanup(RBSHM* rb){
+  if ((rb != 0) && (*rb != 0)){
+#ifdef RBSHM_HAS_SHM
+    munmap((*rb)->head, (*rb)->bytes);
+    close((*rb)->fd);
+#endif
+    free(*rb);
+    *rb = 0;
+  }
+}
+
+int rbshmUnlink(const char* name){
+#ifdef RBSHM_HAS_SHM
+  if (name == 0){
+    return -1;
+  }
+  return (shm_unlink(name) == 0)?0:-1;
+#else
+  (void) name;
+  return -1;
+#endif
+}
+
+int rbshmFd(const RBSHM rb){
+  if (rb == 0){
+    return -1;
+  }
+  return rb->fd;
+}
+
+size_t rbshmCap(const RBSHM rb){
+  if (rb == 0){
+    return 0;
+  }
+  return (size_t)(rb->mask + 1);
+}
+
+size_t rbshmItemSize(const RBSHM rb){
+  if (rb == 0){
+    return 0;
+  }
+  return rb->isize;
+}
+
+size_t rbshmSize(const RBSHM rb){
+  uint64_t head = 0;
+  uint64_t tail = 0;
+
+  if (rb == 0){
+    return 0;
+  }
+  head = atomic_load_explicit(&rb->head->head, memory_order_relaxed);
+  tail = atomic_load_explicit(&rb->head->tail, memory_order_relaxed);
+  return (tail > head)?(size_t)(tail - head):0;
+}
+
+void* rbshmReserve(RBSHM rb, uint64_t* ticket){
+  rbshmSlot* slot = 0;
+  uint64_t pos = 0;
+  uint64_t seq = 0;
+
+  if ((rb == 0) || (ticket == 0)){
+    return 0;
+  }
+
+  pos = atomic_load_explicit(&rb->head->tail, memory_order_relaxed);
+  for (;;){
+    slot = rbshmSlotAt(rb, pos);
+    seq = atomic_load_explicit(&slot->seq, memory_order_acquire);
+    if (seq == pos){
+      if (atomic_compare_exchange_weak_explicit(&rb->head->tail, &pos, pos + 1,
+          memory_order_relaxed, memory_order_relaxed)){
+        break;
+      }
+    }else if ((int64_t)(seq - pos) < 0){
+      // Slot still holds record of previous lap
+      return 0;
+    }else{
+      pos = atomic_load_explicit(&rb->head->tail, memory_order_relaxed);
+    }
+  }
+
+  *ticket = pos;
+  return slot + 1;
+}
+
+int rbshmCommit(RBSHM rb, uint64_t ticket, size_t size){
+  rbshmSlot* slot = 0;
+
+  if ((rb == 0) || (size > rb->isize)){
+    return -1;
+  }
+
+  slot = rbshmSlotAt(rb, ticket);
+  if (atomic_load_explicit(&slot->seq, memory_order_relaxed) != ticket){
+    return -1;
+  }
+  slot->size = size;
+  atomic_store_explicit(&slot->seq, ticket + 1, memory_order_release);
+  return 0;
+}
+
+const void* rbshmPeek(RBSHM rb, uint64_t* ticket, size_t* size){
+  rbshmSlot* slot = 0;
+  uint64_t pos = 0;
+  uint64_t seq = 0;
+  uint64_t len = 0;
+
+  if ((rb == 0) || (ticket == 0)){
+    return 0;
+  }
+
+  pos = atomic_load_explicit(&rb->head->head, memory_order_relaxed);
+  for (;;){
+    slot = rbshmSlotAt(rb, pos);
+    seq = atomic_load_explicit(&slot->seq, memory_order_acquire);
+    if (seq == pos + 1){
+      if (atomic_compare_exchange_weak_explicit(&rb->head->head, &pos, pos + 1,
+          memory_order_relaxed, memory_order_relaxed)){
+        break;
+      }
+    }else if ((int64_t)(seq - (pos + 1)) < 0){
+      // Slot is not written yet
+      return 0;
+    }else{
+      pos = atomic_load_explicit(&rb->head->head, memory_order_relaxed);
+    }
+  }
+
+  *ticket = pos;
+  if (size != 0){
+    /* Size comes from peer, never let it exceed slot */
+    len = slot->size;
+    *size = (len > rb->isize)?rb->isize:(size_t) len;
+  }
+  return slot + 1;
+}
+
+int rbshmRelease(RBSHM rb, uint64_t ticket){
+  rbshmSlot* slot = 0;
+
+  if (rb == 0){
+    return -1;
+  }
+
+  slot = rbshmSlotAt(rb, ticket);
+  if (atomic_load_explicit(&slot->seq, memory_order_relaxed) != ticket + 1){
+    return -1;
+  }
+  atomic_store_explicit(&slot->seq, ticket + rb->mask + 1, memory_order_release);
+  return 0;
+}
+
+int rbshmPush(RBSHM rb, const void* data, size_t size){
+  uint64_t ticket = 0;
+  void* dst = 0;
+
+  if ((rb == 0) || (size > rb->isize) || ((data == 0) && (size != 0))){
+    return -1;
+  }
+
+  dst = rbshmReserve(rb, &ticket);
+  if (dst == 0){
+    return -1;
+  }
+  if (size != 0){
+    memcpy(dst, data, size);
+  }
+  return rbshmCommit(rb, ticket, size);
+}
+
+int rbshmPop(RBSHM rb, void* data, size_t* size){
+  uint64_t ticket = 0;
+  size_t len = 0;
+  const void* src = 0;
+
+  src = rbshmPeek(rb, &ticket, &len);
+  if (src == 0){
+    return -1;
+  }
+  if ((data != 0) && (len != 0)){
+    memcpy(data, src, len);
+  }
+  if (size != 0){
+    *size = len;
+  }
+  return rbshmRelease(rb, ticket);
+}
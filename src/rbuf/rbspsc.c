@@ -0,0 +1,308 @@
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/eventfd.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <time.h>
+#include <errno.h>
+#define RBSPSC_HAS_WAIT
+#endif
+
+#include <stdatomic.h>
+
+#include <rbspsc.h>
+#include "rbpriv.h"
+
+/**
+ * Number of empty checks before consumer goes to sleep.
+ */
+#define RBSPSC_SPIN (128)
+
+/**
+ * Internal structure of SPSC ring buffer.
+ *
+ * Indexes run freely and are masked only on slot access, so head == tail
+ * means empty and tail - head == cap means full. Producer writes tail
+ * and reads head only when its cached copy says ring is full. Consumer
+ * does the same with head and tail.
+ *
+ * Consumer, which found ring empty, sets sleeping flag and checks tail
+ * again, producer checks flag after publishing tail. Both sides put
+ * full fence between store and load, so either consumer sees new item
+ * or producer sees flag, clears it and wakes consumer. Producer of ring
+ * with consumer awake never makes system calls.
+ */
+struct _rbspsc_ {
+  size_t mask; /**< Capacity - 1, capacity is power of two */
+  void** data; /**< Slots */
+  uint32_t flags; /**< Ring modes */
+  int efd; /**< Event file descriptor, -1 if not used */
+  _Alignas(RB_CACHE_LINE) _Atomic(uint32_t) sleeping; /**< Consumer waits for items, futex word */
+  _Alignas(RB_CACHE_LINE) _Atomic(size_t) tail; /**< Next slot to write, owned by producer */
+  size_t headCache; /**< Last head seen by producer */
+  _Alignas(RB_CACHE_LINE) _Atomic(size_t) head; /**< Next slot to read, owned by consumer */
+  size_t tailCache; /**< Last tail seen by consumer */
+};
+
+#ifdef RBSPSC_HAS_WAIT
+
+/**
+ * Wake consumer, if it sleeps on empty ring.
+ */
+static void rbspscWake(RBSPSC rb){
+  uint64_t one = 1;
+
+  atomic_thread_fence(memory_order_seq_cst);
+  if (atomic_load_explicit(&rb->sleeping, memory_order_relaxed) == 0){
+    return;
+  }
+  if (atomic_exchange_explicit(&rb->sleeping, 0, memory_order_relaxed) == 0){
+    return;
+  }
+  syscall(SYS_futex, &rb->sleeping, FUTEX_WAKE_PRIVATE, 1, 0, 0, 0);
+  if (rb->efd >= 0){
+    if (write(rb->efd, &one, sizeof(one)) != sizeof(one)){
+      // Counter overflow only, reader is already notified
+    }
+  }
+}
+
+/**
+ * Announce, that consumer is going to wait, and check ring again.
+ *
+ * @return 1 if ring is still empty, 0 otherwise
+ */
+static int rbspscArm(RBSPSC rb){
+  size_t head = atomic_load_explicit(&rb->head, memory_order_relaxed);
+
+  atomic_store_explicit(&rb->sleeping, 1, memory_order_relaxed);
+  atomic_thread_fence(memory_order_seq_cst);
+  if (atomic_load_explicit(&rb->tail, memory_order_relaxed) != head){
+    atomic_store_explicit(&rb->sleeping, 0, memory_order_relaxed);
+    return 0;
+  }
+  return 1;
+}
+
+#endif /* RBSPSC_HAS_WAIT */
+
+RBSPSC rbspscInit(size_t icap){
+  return rbspscInitEx(icap, RBSPSC_DEFAULT);
+}
+
+RBSPSC rbspscInitEx(size_t icap, uint32_t flags){
+  RBSPSC result = 0;
+  size_t cap = rbRoundCap(icap);
+
+  if (cap == 0){
+    return 0;
+  }
+
+#ifndef RBSPSC_HAS_WAIT
+  if (flags != RBSPSC_DEFAULT){
+    return 0;
+  }
+#endif
+
+  result = (RBSPSC)aligned_alloc(RB_CACHE_LINE, sizeof(struct _rbspsc_));
+  if (result == 0){
+    return 0;
+  }
+
+  result->data = (void**)calloc(cap, sizeof(void*));
+  if (result->data == 0){
+    free(result);
+    return 0;
+  }
+
+  result->mask = cap - 1;
+  result->flags = flags;
+  result->efd = -1;
+#ifdef RBSPSC_HAS_WAIT
+  if (flags & RBSPSC_EVENTFD){
+    result->flags |= RBSPSC_BLOCKING;
+    result->efd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (result->efd < 0){
+      free(result->data);
+      free(result);
+      return 0;
+    }
+  }
+#endif
+  atomic_init(&result->sleeping, (result->efd >= 0)?1:0); // Event ring starts armed
+  atomic_init(&result->tail, 0);
+  result->headCache = 0;
+  atomic_init(&result->head, 0);
+  result->tailCache = 0;
+  return result;
+}
+
+void rbspscCleanup(RBSPSC* rb){
+  if ((rb != 0) && (*rb != 0)){
+#ifdef RBSPSC_HAS_WAIT
+    if ((*rb)->efd >= 0){
+      close((*rb)->efd);
+    }
+#endif
+    free((*rb)->data);
+    free(*rb);
+    *rb = 0;
+  }
+}
+
+size_t rbspscCap(const RBSPSC rb){
+  if (rb == 0){
+    return 0;
+  }
+  return rb->mask + 1;
+}
+
+size_t rbspscSize(const RBSPSC rb){
+  size_t head = 0;
+  size_t tail = 0;
+
+  if (rb == 0){
+    return 0;
+  }
+  head = atomic_load_explicit(&rb->head, memory_order_acquire);
+  tail = atomic_load_explicit(&rb->tail, memory_order_acquire);
+  return tail - head;
+}
+
+int rbspscPush(RBSPSC rb, void* data){
+  size_t tail = 0;
+
+  if (rb == 0){
+    return -1;
+  }
+
+  tail = atomic_load_explicit(&rb->tail, memory_order_relaxed);
+  if (tail - rb->headCache > rb->mask){
+    // Acquire pairs with consumer release, so slot is not read anymore
+    rb->headCache = atomic_load_explicit(&rb->head, memory_order_acquire);
+    if (tail - rb->headCache > rb->mask){
+      return -1;
+    }
+  }
+
+  rb->data[tail & rb->mask] = data;
+  atomic_store_explicit(&rb->tail, tail + 1, memory_order_release);
+#ifdef RBSPSC_HAS_WAIT
+  if (rb->flags & RBSPSC_BLOCKING){
+    rbspscWake(rb);
+  }
+#endif
+  return 0;
+}
+
+int rbspscPop(RBSPSC rb, void** data){
+  size_t head = 0;
+#ifdef RBSPSC_HAS_WAIT
+  uint64_t count = 0;
+#endif
+
+  if (rb == 0){
+    return -1;
+  }
+
+  head = atomic_load_explicit(&rb->head, memory_order_relaxed);
+  if (head == rb->tailCache){
+    // Acquire pairs with producer release, so slot is already written
+    rb->tailCache = atomic_load_explicit(&rb->tail, memory_order_acquire);
+    if (head == rb->tailCache){
+#ifdef RBSPSC_HAS_WAIT
+      if ((rb->efd < 0) || (atomic_load_explicit(&rb->sleeping, memory_order_relaxed) != 0)){
+        return -1;
+      }
+      // Event was consumed, drain counter and arm again
+      if (read(rb->efd, &count, sizeof(count)) < 0){
+        // Counter is already zero
+      }
+      if (rbspscArm(rb)){
+        return -1;
+      }
+      rb->tailCache = atomic_load_explicit(&rb->tail, memory_order_acquire);
+#else
+      return -1;
+#endif
+    }
+  }
+
+  if (data != 0){
+    *data = rb->data[head & rb->mask];
+  }
+  atomic_store_explicit(&rb->head, head + 1, memory_order_release);
+  return 0;
+}
+
+int rbspscPopWait(RBSPSC rb, void** data, int timeout){
+#ifdef RBSPSC_HAS_WAIT
+  struct timespec deadline;
+  struct timespec now;
+  struct timespec left;
+  uint32_t spin = 0;
+
+  if ((rb == 0) || !(rb->flags & RBSPSC_BLOCKING)){
+    return -1;
+  }
+
+  if (timeout > 0){
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    deadline.tv_sec += timeout/1000;
+    deadline.tv_nsec += (timeout%1000)*1000000L;
+    if (deadline.tv_nsec >= 1000000000L){
+      deadline.tv_nsec -= 1000000000L;
+      ++deadline.tv_sec;
+    }
+  }
+
+  for (;;){
+    if (rbspscPop(rb, data) == 0){
+      return 0;
+    }
+    if (spin < RBSPSC_SPIN){
+      ++spin;
+      continue;
+    }
+    if (timeout == 0){
+      return -1;
+    }
+    if (!rbspscArm(rb)){
+      continue;
+    }
+
+    if (timeout > 0){
+      clock_gettime(CLOCK_MONOTONIC, &now);
+      left.tv_sec = deadline.tv_sec - now.tv_sec;
+      left.tv_nsec = deadline.tv_nsec - now.tv_nsec;
+      if (left.tv_nsec < 0){
+        left.tv_nsec += 1000000000L;
+        --left.tv_sec;
+      }
+      if (left.tv_sec < 0){
+        atomic_store_explicit(&rb->sleeping, 0, memory_order_relaxed);
+        return rbspscPop(rb, data);
+      }
+    }
+
+    // Returns at once, if producer cleared flag after arming
+    if ((syscall(SYS_futex, &rb->sleeping, FUTEX_WAIT_PRIVATE, 1, (timeout > 0)?&left:0, 0, 0) != 0)
+      && (errno == ETIMEDOUT)){
+      atomic_store_explicit(&rb->sleeping, 0, memory_order_relaxed);
+      return rbspscPop(rb, data);
+    }
+  }
+#else
+  (void) rb;
+  (void) data;
+  (void) timeout;
+  return -1;
+#endif
+}
+
+int rbspscEventFd(const RBSPSC rb){
+  if (rb == 0){
+    return -1;
+  }
+  return rb->efd;
+}
@@ -0,0 +1,329 @@
+#include <stdatomic.h>
+#include <pthread.h>
+#include <sched.h>
+#include <string.h>
+
+#include <udconc.h>
+#include "udpriv.h"
+
+/**
+ * Size of cache line, readers keep their epochs on separate lines.
+ */
+#define UDC_CACHE_LINE (64)
+
+/**
+ * Immutable capacity table with atomically published buckets.
+ *
+ * Bucket is published by release store of its control byte, after key
+ * and value are written, so reader seeing non-empty control byte sees
+ * whole item. Items are never removed, so probe sequence seen by
+ * reader stays valid while table is alive.
+ */
+typedef struct _udconc_table_ {
+  uint32_t cap; /**< Capacity, always power of two */
+  _Atomic(void*)* vals; /**< Values */
+  uint32_t* keys; /**< Keys */
+  _Atomic(uint8_t)* ctrl; /**< Control bytes */
+} udcTable;
+
+/**
+ * Registered reader.
+ *
+ * Epoch is written only by owning thread and read by writers during
+ * grace period, so it lives on its own cache line.
+ */
+struct _udconc_reader_ {
+  _Alignas(UDC_CACHE_LINE) _Atomic(uint64_t) epoch; /**< Epoch at read section start, zero outside */
+  UDCONC uc; /**< Owner */
+  UDCREADER next; /**< Next registered reader */
+};
+
+/**
+ * Internal structure of concurrent hash table.
+ */
+struct _udconc_ {
+  _Atomic(udcTable*) table; /**< Actual table, read by everyone */
+  _Atomic(uint64_t) epoch; /**< Global epoch, changed on table replacement */
+  _Alignas(UDC_CACHE_LINE) pthread_mutex_t lock; /**< Serializes writers and reader registration */
+  _Atomic(uint32_t) size; /**< Size */
+  UDCREADER readers; /**< Registered readers */
+};
+
+static udcTable* udcTableInit(uint32_t cap){
+  udcTable* result = (udcTable*)calloc(1,
+    sizeof(udcTable) + cap*(sizeof(_Atomic(void*)) + sizeof(uint32_t) + sizeof(_Atomic(uint8_t)))
+  );
+  if (result == 0){
+    return 0;
+  }
+  result->cap = cap;
+  result->vals = (_Atomic(void*)*)(result + 1);
+  result->keys = (uint32_t*)(result->vals + cap);
+  result->ctrl = (_Atomic(uint8_t)*)(result->keys + cap);
+  return result;
+}
+
+/**
+ * Find bucket with key, or empty bucket where key must be inserted.
+ *
+ * @return 1 if key found, 0 if empty bucket found
+ */
+static int udcProbe(const udcTable* tab, uint32_t key, uint32_t* pos){
+  uint32_t hash = udHashMix(key);
+  uint8_t tag = udTag(hash);
+  uint32_t plk = hash & (tab->cap - 1);
+
+  for (;;){
+    uint8_t ctrl = atomic_load_explicit(tab->ctrl + plk, memory_order_acquire);
+    if (ctrl == UD_CTRL_EMPTY){
+      *pos = plk;
+      return 0;
+    }
+    if ((ctrl == tag) && (tab->keys[plk] == key)){
+      *pos = plk;
+      return 1;
+    }
+    plk = (plk + 1) & (tab->cap - 1);
+  }
+}
+
+/**
+ * Write item to bucket and publish it to readers.
+ */
+static void udcTableSet(udcTable* tab, uint32_t pos, uint32_t key, void* value){
+  tab->keys[pos] = key;
+  atomic_store_explicit(tab->vals + pos, value, memory_order_relaxed);
+  atomic_store_explicit(tab->ctrl + pos, udTag(udHashMix(key)), memory_order_release);
+}
+
+/**
+ * Wait until every reader, which could see replaced table, leaves its
+ * read section. Called with writer lock held.
+ */
+static void udcSynchronize(UDCONC uc){
+  uint64_t target = atomic_fetch_add(&uc->epoch, 1) + 1;
+  UDCREADER cur = 0;
+
+  /* Pairs with fence in udcReadBegin: either reader sees new table, or we see its epoch */
+  atomic_thread_fence(memory_order_seq_cst);
+
+  for (cur = uc->readers; cur != 0; cur = cur->next){
+    for (;;){
+      uint64_t epoch = atomic_load_explicit(&cur->epoch, memory_order_acquire);
+      if ((epoch == 0) || (epoch >= target)){
+        break;
+      }
+      sched_yield();
+    }
+  }
+}
+
+/**
+ * Copy items to twice larger table, publish it and free old one after
+ * grace period. Called with writer lock held.
+ */
+static int udcGrow(UDCONC uc, udcTable* tab){
+  udcTable* next = 0;
+  uint32_t i = 0;
+
+  if (tab->cap > 0x40000000u){
+    return -1;
+  }
+
+  next = udcTableInit(tab->cap*2);
+  if (next == 0){
+    return -1;
+  }
+
+  for (i = 0; i < tab->cap; ++i){
+    if (atomic_load_explicit(tab->ctrl + i, memory_order_relaxed) != UD_CTRL_EMPTY){
+      uint32_t pos = 0;
+      udcProbe(next, tab->keys[i], &pos);
+      udcTableSet(next, pos, tab->keys[i], atomic_load_explicit(tab->vals + i, memory_order_relaxed));
+    }
+  }
+
+  atomic_store_explicit(&uc->table, next, memory_order_release);
+  udcSynchronize(uc);
+  free(tab);
+  return 0;
+}
+
+UDCONC udcInit(uint32_t icap){
+  UDCONC result = 0;
+  udcTable* tab = 0;
+  uint32_t cap = 1;
+
+  if ((icap == 0) || (icap > 0x80000000u)){
+    return 0;
+  }
+
+  while (cap < icap){
+    cap <<= 1;
+  }
+
+  result = (UDCONC)aligned_alloc(UDC_CACHE_LINE, sizeof(struct _udconc_));
+  if (result == 0){
+    return 0;
+  }
+
+  tab = udcTableInit(cap);
+  if (tab == 0){
+    free(result);
+    return 0;
+  }
+
+  if (pthread_mutex_init(&result->lock, 0) != 0){
+    free(tab);
+    free(result);
+    return 0;
+  }
+
+  atomic_init(&result->table, tab);
+  atomic_init(&result->epoch, 1);
+  atomic_init(&result->size, 0);
+  result->readers = 0;
+  return result;
+}
+
+void udcCleanup(UDCONC* uc){
+  if ((uc != 0) && (*uc != 0)){
+    while ((*uc)->readers != 0){
+      UDCREADER next = (*uc)->readers->next;
+      free((*uc)->readers);
+      (*uc)->readers = next;
+    }
+    free(atomic_load_explicit(&(*uc)->table, memory_order_relaxed));
+    pthread_mutex_destroy(&(*uc)->lock);
+    free(*uc);
+    *uc = 0;
+  }
+}
+
+uint32_t udcSize(const UDCONC uc){
+  if (uc == 0){
+    return 0;
+  }
+  return atomic_load_explicit(&uc->size, memory_order_relaxed);
+}
+
+int udcReset(UDCONC uc, uint32_t key, void* value){
+  udcTable* tab = 0;
+  uint32_t pos = 0;
+  uint32_t size = 0;
+
+  if (uc == 0){
+    return -1;
+  }
+
+  pthread_mutex_lock(&uc->lock);
+  tab = atomic_load_explicit(&uc->table, memory_order_relaxed);
+
+  if (udcProbe(tab, key, &pos) != 0){
+    atomic_store_explicit(tab->vals + pos, value, memory_order_release);
+    pthread_mutex_unlock(&uc->lock);
+    return 0;
+  }
+
+  size = atomic_load_explicit(&uc->size, memory_order_relaxed);
+  if (size + 1 > UD_LOAD_LIMIT(tab->cap)){
+    if (udcGrow(uc, tab) != 0){
+      pthread_mutex_unlock(&uc->lock);
+      return -1;
+    }
+    tab = atomic_load_explicit(&uc->table, memory_order_relaxed);
+    udcProbe(tab, key, &pos);
+  }
+
+  udcTableSet(tab, pos, key, value);
+  atomic_store_explicit(&uc->size, size + 1, memory_order_relaxed);
+  pthread_mutex_unlock(&uc->lock);
+  return 0;
+}
+
+UDCREADER udcAttach(UDCONC uc){
+  UDCREADER result = 0;
+
+  if (uc == 0){
+    return 0;
+  }
+
+  result = (UDCREADER)aligned_alloc(UDC_CACHE_LINE, sizeof(struct _udconc_reader_));
+  if (result == 0){
+    return 0;
+  }
+  atomic_init(&result->epoch, 0);
+  result->uc = uc;
+
+  pthread_mutex_lock(&uc->lock);
+  result->next = uc->readers;
+  uc->readers = result;
+  pthread_mutex_unlock(&uc->lock);
+  return result;
+}
+
+void udcDetach(UDCREADER* rd){
+  UDCREADER* cur = 0;
+  UDCONC uc = 0;
+
+  if ((rd == 0) || (*rd == 0)){
+    return;
+  }
+
+  uc = (*rd)->uc;
+  pthread_mutex_lock(&uc->lock);
+  for (cur = &uc->readers; *cur != 0; cur = &(*cur)->next){
+    if (*cur == *rd){
+      *cur = (*rd)->next;
+      break;
+    }
+  }
+  pthread_mutex_unlock(&uc->lock);
+
+  free(*rd);
+  *rd = 0;
+}
+
+void udcReadBegin(UDCREADER rd){
+  atomic_store_explicit(&rd->epoch,
+    atomic_load_explicit(&rd->uc->epoch, memory_order_acquire),
+    memory_order_relaxed
+  );
+  /* Writer must see our epoch before we look at table */
+  atomic_thread_fence(memory_order_seq_cst);
+}
+
+void udcReadEnd(UDCREADER rd){
+  atomic_store_explicit(&rd->epoch, 0, memory_order_release);
+}
+
+int udcFind(UDCREADER rd, uint32_t key, void** value){
+  udcTable* tab = 0;
+  uint32_t pos = 0;
+
+  if (rd == 0){
+    return 0;
+  }
+
+  tab = atomic_load_explicit(&rd->uc->table, memory_order_acquire);
+  if (udcProbe(tab, key, &pos) == 0){
+    return 0;
+  }
+  if (value != 0){
+    *value = atomic_load_explicit(tab->vals + pos, memory_order_acquire);
+  }
+  return 1;
+}
+
+void* udcGet(UDCREADER rd, uint32_t key){
+  void* result = 0;
+
+  if (rd == 0){
+    return 0;
+  }
+
+  udcReadBegin(rd);
+  udcFind(rd, key, &result);
+  udcReadEnd(rd);
+  return result;
+}
@@ -0,0 +1,28 @@
+#include <udict.h>
+
+#define UD_KEY uint32_t
+#define UD_DICT UDICT
+#define UD_ITEM UDITEM
+#define UD_DICT_STRUCT struct _udict_
+#define UD_ITEM_STRUCT struct _udict_item_
+#define UD_HASH_FUNC udHashFunc
+#define UD_CLEANUP_FUNC udCleanupFunc
+#define UD_HASH_DEFAULT udHashMix
+#define UD_HASH_IDENTITY udHashIdentity
+#define UD_FN(name) ud##name
+
+#include "udimpl.h"
+
+uint32_t udHashMix(uint32_t key){
+  /* MurmurHash3 finalizer */
+  key ^= key >> 16;
+  key *= 0x85ebca6b;
+  key ^= key >> 13;
+  key *= 0xc2b2ae35;
+  key ^= key >> 16;
+  return key;
+}
+
+uint32_t udHashIdentity(uint32_t key){
+  return key;
+}
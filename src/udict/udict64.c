@@ -0,0 +1,28 @@
+#include <udict64.h>
+
+#define UD_KEY uint64_t
+#define UD_DICT UDICT64
+#define UD_ITEM UDITEM64
+#define UD_DICT_STRUCT struct _udict64_
+#define UD_ITEM_STRUCT struct _udict64_item_
+#define UD_HASH_FUNC ud64HashFunc
+#define UD_CLEANUP_FUNC ud64CleanupFunc
+#define UD_HASH_DEFAULT ud64HashMix
+#define UD_HASH_IDENTITY ud64HashIdentity
+#define UD_FN(name) ud64##name
+
+#include "udimpl.h"
+
+uint32_t ud64HashMix(uint64_t key){
+  /* MurmurHash3 64-bit finalizer */
+  key ^= key >> 33;
+  key *= 0xff51afd7ed558ccdull;
+  key ^= key >> 33;
+  key *= 0xc4ceb9fe1a85ec53ull;
+  key ^= key >> 33;
+  return (uint32_t)(key ^ (key >> 32));
+}
+
+uint32_t ud64HashIdentity(uint64_t key){
+  return (uint32_t)(key ^ (key >> 32));
+}
@@ -0,0 +1,1608 @@
+/**
+ * @file udimpl.h
+ * @author masscry
+ *
+ * UDICT implementation for any fixed-width key.
+ *
+ * Included once by every key width translation unit, after defining:
+ *
+ *  - UD_KEY          key type, its size must be multiple of 4 bytes;
+ *  - UD_KEY_EQ(a, b) key comparison, optional, == by default;
+ *  - UD_DICT         public table handle type;
+ *  - UD_ITEM         public item handle type;
+ *  - UD_DICT_STRUCT  struct tag behind UD_DICT;
+ *  - UD_ITEM_STRUCT  struct tag behind UD_ITEM;
+ *  - UD_HASH_FUNC    hashing policy type;
+ *  - UD_CLEANUP_FUNC item cleanup function type;
+ *  - UD_HASH_DEFAULT default hashing policy;
+ *  - UD_HASH_IDENTITY identity hashing policy;
+ *  - UD_FN(name)     public function name.
+ *
+ * Public functions must be declared with UDICT_DECLARE from udtempl.h,
+ * or by hand, as done for 32-bit keys in udict.h.
+ *
+ */
+
+#include <stdio.h>
+#include <stddef.h>
+#include <string.h>
+#include <pthread.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#define UD_HAS_MMAP
+#endif
+
+#include "udpriv.h"
+
+#ifndef UD_KEY_EQ
+#define UD_KEY_EQ(a, b) ((a) == (b))
+#endif
+
+/**
+ * Internal structure of hash table item in UD_DEFAULT layout.
+ *
+ * Value goes first, so UDITEM of every layout points to value. Key is
+ * read at udValueSpace(sizeof(void*)) offset, as table layout puts it.
+ */
+UD_ITEM_STRUCT {
+  void* value; /**< Value */
+  UD_KEY key; /**< Key */
+};
+
+/**
+ * Bucket arrays of hash table.
+ *
+ * Keys and values are addressed through first element and stride, so
+ * interleaved and UD_SOA layouts share the same code.
+ */
+typedef struct _udict_table_ {
+  uint32_t cap; /**< Capacity, always power of two */
+  uint32_t size; /**< Size */
+  UD_HASH_FUNC hash; /**< Key hashing policy */
+  uint32_t* dups; /**< Number of duplicates */
+  uint32_t* dist; /**< Item distance from home bucket, only in UD_ROBINHOOD mode */
+  uint8_t* ctrl; /**< Control bytes, cap + UD_GROUP_WIDTH mirrored at the end */
+  uint64_t* occ; /**< Bitmap of active buckets, also start of allocated chunk */
+  char* keys; /**< First key */
+  char* vals; /**< First value */
+  uint32_t kstride; /**< Distance between keys */
+  uint32_t vstride; /**< Distance between values */
+  uint32_t vsize; /**< Value size, sizeof(void*) unless UD_INLINE */
+#ifdef UD_STATS_COUNTERS
+  udCounters* counters; /**< Counters of owning table */
+#endif
+} udTable;
+
+/**
+ * Internal structure of hash table
+ */
+UD_DICT_STRUCT {
+  udTable tab; /**< Actual table */
+  udTable old; /**< Table being migrated to actual one in UD_INCREMENTAL mode */
+  uint32_t cursor; /**< Next bucket of old table to migrate */
+  uint32_t flags; /**< Table mode */
+  void* map; /**< File mapping of UD_READONLY table */
+  size_t mapSize; /**< File mapping size */
+#ifdef UD_STATS_COUNTERS
+  udCounters counters; /**< Operation counters */
+#endif
+};
+
+/**
+ * Set bucket control byte, its mirror in the tail and occupancy bit.
+ */
+static INLINE void udSetCtrl(udTable* tab, uint32_t pos, uint8_t value) {
+  uint32_t mirror = 0;
+  if (value == UD_CTRL_EMPTY) {
+    tab->occ[pos >> 6] &= ~(1ull << (pos & 63));
+  } else {
+    tab->occ[pos >> 6] |= 1ull << (pos & 63);
+  }
+  tab->ctrl[pos] = value;
+  for (mirror = pos + tab->cap; mirror < tab->cap + UD_GROUP_WIDTH; mirror += tab->cap) {
+    tab->ctrl[mirror] = value;
+  }
+}
+
+/**
+ * Get key stored in bucket.
+ */
+static INLINE UD_KEY* udKeyAt(const udTable* tab, uint32_t pos) {
+  return (UD_KEY*)(tab->keys + (size_t)pos*tab->kstride);
+}
+
+/**
+ * Get item stored in bucket.
+ */
+static INLINE UD_ITEM udItemAt(const udTable* tab, uint32_t pos) {
+  return (UD_ITEM)(tab->vals + (size_t)pos*tab->vstride);
+}
+
+/**
+ * Get bucket index of item.
+ */
+static INLINE uint32_t udItemPos(const udTable* tab, const UD_ITEM item) {
+  return (uint32_t)(((const char*)item - tab->vals)/tab->vstride);
+}
+
+/**
+ * Does item belong to table.
+ */
+static INLINE int udTableHas(const udTable* tab, const UD_ITEM item) {
+  return (tab->vals != 0)
+    && ((const char*)item >= tab->vals)
+    && ((const char*)item < tab->vals + (size_t)tab->cap*tab->vstride);
+}
+
+/**
+ * Copy value bytes, zero source means zero value.
+ */
+static INLINE void udValueCopy(const udTable* tab, void* dst, const void* src) {
+  if (src == 0) {
+    memset(dst, 0, tab->vsize);
+  } else if (tab->vsize == sizeof(void*)) {
+    memcpy(dst, src, sizeof(void*));
+  } else {
+    memcpy(dst, src, tab->vsize);
+  }
+}
+
+/**
+ * udProbe results.
+ */
+enum udProbeResult {
+  UD_PROBE_NONE = 0, /**< Looped over whole table */
+  UD_PROBE_KEY = 1, /**< Stopped at bucket with equal key */
+  UD_PROBE_EMPTY = 2 /**< Stopped at empty bucket */
+};
+
+/**
+ * Test one group of control bytes in linear probing order.
+ *
+ * @param tab table
+ * @param key key to look for
+ * @param tag control byte of key
+ * @param plk first bucket of group, on return first bucket of next group
+ * @param left maximum number of buckets to test, decreased by group width
+ * @param countDups if non zero, do not stop at equal keys, but increment their dups
+ * @param pos found bucket index
+ * @return one of udProbeResult, UD_PROBE_NONE means probing goes on
+ */
+static INLINE int udProbeGroup(udTable* tab, UD_KEY key, uint8_t tag, uint32_t* plk, uint32_t* left, int countDups, uint32_t* pos){
+  uint32_t width = (*left < UD_GROUP_WIDTH)?*left:UD_GROUP_WIDTH;
+  uint32_t match = udGroupMatch(tab->ctrl + *plk, tag) & udMaskWidth(width);
+  uint32_t empty = udGroupMatch(tab->ctrl + *plk, UD_CTRL_EMPTY) & udMaskWidth(width);
+
+  if (empty != 0){ /* Nothing after first empty bucket belongs to this key */
+    match &= (empty & (~empty + 1)) - 1;
+  }
+
+  while (match != 0) {
+    uint32_t ind = *plk + udMaskFirst(match);
+    if (ind >= tab->cap){
+      ind -= tab->cap;
+    }
+    if (UD_KEY_EQ(*udKeyAt(tab, ind), key)){
+      if (countDups == 0){
+        *pos = ind;
+        return UD_PROBE_KEY;
+      }
+      ++tab->dups[ind];
+    }
+    match &= match - 1;
+  }
+
+  UD_COUNT(tab, probes);
+  if (empty != 0){
+    *pos = *plk + udMaskFirst(empty);
+    if (*pos >= tab->cap){
+      *pos -= tab->cap;
+    }
+    return UD_PROBE_EMPTY;
+  }
+
+  *plk += width;
+  if (*plk >= tab->cap){ /* rewind to start */
+    *plk -= tab->cap;
+    UD_COUNT(tab, wraps);
+  }
+  *left -= width;
+  return UD_PROBE_NONE;
+}
+
+/**
+ * Walk buckets in linear probing order, one group of control bytes at time.
+ *
+ * @param tab table
+ * @param key key to look for
+ * @param hash key hash
+ * @param plk first bucket to test
+ * @param left maximum number of buckets to test
+ * @param countDups if non zero, do not stop at equal keys, but increment their dups
+ * @param pos found bucket index
+ * @return one of udProbeResult
+ */
+static int udProbe(udTable* tab, UD_KEY key, uint32_t hash, uint32_t plk, uint32_t left, int countDups, uint32_t* pos){
+  uint8_t tag = udTag(hash);
+
+  while (left > 0) {
+    int result = udProbeGroup(tab, key, tag, &plk, &left, countDups, pos);
+    if (result != UD_PROBE_NONE){
+      return result;
+    }
+  }
+  return UD_PROBE_NONE;
+}
+
+/**
+ * Walk buckets in Robin Hood probing order.
+ *
+ * Stops at bucket, which item is closer to its home, than key would be.
+ *
+ * @param tab table
+ * @param key key to look for
+ * @param hash key hash
+ * @param plk first bucket to test
+ * @param dist distance of first bucket from home bucket
+ * @param pos found bucket index
+ * @return one of udProbeResult
+ */
+static int udProbeRobin(const udTable* tab, UD_KEY key, uint32_t hash, uint32_t plk, uint32_t dist, uint32_t* pos){
+  uint8_t tag = udTag(hash);
+
+  for (; dist < tab->cap; ++dist){
+    UD_COUNT(tab, probes);
+    if ((tab->ctrl[plk] == UD_CTRL_EMPTY) || (tab->dist[plk] < dist)){
+      return UD_PROBE_EMPTY;
+    }
+    if ((tab->ctrl[plk] == tag) && UD_KEY_EQ(*udKeyAt(tab, plk), key)){
+      *pos = plk;
+      return UD_PROBE_KEY;
+    }
+    if (++plk == tab->cap){
+      plk = 0;
+      UD_COUNT(tab, wraps);
+    }
+  }
+  return UD_PROBE_NONE;
+}
+
+/**
+ * Value slot size, value slots are 8 byte aligned, so keys after them are too.
+ */
+static INLINE size_t udValueSpace(uint32_t vsize){
+  return ((size_t)vsize + 7) & ~(size_t)7;
+}
+
+/**
+ * Bucket size in key-value array, or sum of key and value sizes in UD_SOA mode.
+ */
+static INLINE size_t udItemSize(uint32_t flags, uint32_t vsize){
+  return ((flags & UD_SOA) != 0)
+    ?(udValueSpace(vsize) + sizeof(UD_KEY))
+    :(udValueSpace(vsize) + ((sizeof(UD_KEY) + 7) & ~(size_t)7));
+}
+
+/**
+ * Size of chunk holding all table arrays.
+ */
+static size_t udTableBytes(uint32_t icap, uint32_t flags, uint32_t vsize){
+  size_t distSize = ((flags & UD_ROBINHOOD) != 0)?sizeof(uint32_t):0;
+  return UD_OCC_WORDS(icap)*sizeof(uint64_t)
+    + icap*(udItemSize(flags, vsize) + sizeof(uint32_t) + distSize + sizeof(uint8_t)) + UD_GROUP_WIDTH;
+}
+
+/**
+ * Setup table arrays in chunk of udTableBytes size.
+ *
+ * Small memory allocation optimization: all arrays live in one chunk.
+ * Bitmap and values go first to keep them aligned, control bytes go
+ * last, because they are bytes.
+ */
+static void udTableLayout(udTable* tab, char* chunk, uint32_t icap, uint32_t flags, UD_HASH_FUNC hash, uint32_t vsize){
+  size_t vspace = udValueSpace(vsize);
+  size_t itemSize = udItemSize(flags, vsize);
+
+  tab->cap = icap;
+  tab->size = 0;
+  tab->hash = hash;
+  tab->vsize = vsize;
+  tab->occ = (uint64_t*)chunk;
+  tab->vals = (char*)(tab->occ + UD_OCC_WORDS(icap));
+  if ((flags & UD_SOA) != 0){
+    tab->vstride = (uint32_t) vspace;
+    tab->keys = tab->vals + icap*vspace;
+    tab->kstride = sizeof(UD_KEY);
+    tab->dups = (uint32_t*)(tab->keys + icap*sizeof(UD_KEY));
+  } else {
+    /* Same as UD_ITEM_STRUCT, when value is void* */
+    tab->vstride = (uint32_t) itemSize;
+    tab->keys = tab->vals + vspace;
+    tab->kstride = (uint32_t) itemSize;
+    tab->dups = (uint32_t*)(tab->vals + icap*itemSize);
+  }
+  tab->dist = ((flags & UD_ROBINHOOD) != 0)?(tab->dups + icap):0;
+  tab->ctrl = (uint8_t*)(tab->dups + icap + ((tab->dist != 0)?icap:0));
+}
+
+static int udTableInit(udTable* tab, uint32_t icap, uint32_t flags, UD_HASH_FUNC hash, uint32_t vsize){
+  char* tmpMem = (char*)calloc(1, udTableBytes(icap, flags, vsize));
+  if (tmpMem == 0){
+    return -1;
+  }
+  udTableLayout(tab, tmpMem, icap, flags, hash, vsize);
+  return 0;
+}
+
+static void udTableCleanup(udTable* tab){
+  free(tab->occ);
+  memset(tab, 0, sizeof(udTable));
+}
+
+/**
+ * Store key and value in bucket.
+ */
+static void udTableSet(udTable* tab, uint32_t pos, uint8_t tag, UD_KEY key, const void* value){
+  udSetCtrl(tab, pos, tag);
+  *udKeyAt(tab, pos) = key;
+  udValueCopy(tab, udItemAt(tab, pos), value);
+}
+
+/**
+ * Move bucket with all its properties to another bucket.
+ */
+static void udTableMove(udTable* tab, uint32_t dst, uint32_t src){
+  udSetCtrl(tab, dst, tab->ctrl[src]);
+  *udKeyAt(tab, dst) = *udKeyAt(tab, src);
+  udValueCopy(tab, udItemAt(tab, dst), udItemAt(tab, src));
+  tab->dups[dst] = tab->dups[src];
+  if (tab->dist != 0){
+    tab->dist[dst] = tab->dist[src];
+  }
+}
+
+/**
+ * Exchange carried item with one stored in bucket.
+ *
+ * Carried value is UD_INLINE_MAX bytes buffer.
+ */
+static void udSwapRobin(udTable* tab, uint32_t plk, uint8_t* tag, UD_KEY* key, void* value, uint32_t* dups, uint32_t* dist){
+  uint8_t tmpTag = tab->ctrl[plk];
+  UD_KEY tmpKey = *udKeyAt(tab, plk);
+  void* tmpValue[UD_INLINE_MAX/sizeof(void*)];
+  uint32_t tmpDups = tab->dups[plk];
+  uint32_t tmpDist = tab->dist[plk];
+
+  udValueCopy(tab, tmpValue, udItemAt(tab, plk));
+  udTableSet(tab, plk, *tag, *key, value);
+  tab->dups[plk] = *dups;
+  tab->dist[plk] = *dist;
+
+  *tag = tmpTag;
+  *key = tmpKey;
+  udValueCopy(tab, value, tmpValue);
+  *dups = tmpDups;
+  *dist = tmpDist;
+}
+
+static UD_ITEM udTableInsertRobin(udTable* tab, UD_KEY key, const void* data){
+  void* value[UD_INLINE_MAX/sizeof(void*)];
+  uint32_t hash = tab->hash(key);
+  uint8_t tag = udTag(hash);
+  uint32_t plk = hash & (tab->cap-1);
+  uint32_t result = tab->cap; /* new item is not placed yet */
+  uint32_t dups = 0;
+  uint32_t dist = 0;
+
+  if (tab->size == tab->cap){ /* No space left */
+    return 0;
+  }
+
+  udValueCopy(tab, value, data);
+  while (tab->ctrl[plk] != UD_CTRL_EMPTY){
+    if (result == tab->cap){
+      if (UD_KEY_EQ(*udKeyAt(tab, plk), key)){
+        /* Equal keys have equal distance, new one goes after them */
+        ++tab->dups[plk];
+      } else if (tab->dist[plk] < dist){
+        udSwapRobin(tab, plk, &tag, &key, value, &dups, &dist);
+        result = plk;
+      }
+    } else if (UD_KEY_EQ(*udKeyAt(tab, plk), key) || (tab->dist[plk] < dist)){
+      /*
+       * Displaced item also swaps with equal keys, so they keep
+       * udNext order.
+       */
+      udSwapRobin(tab, plk, &tag, &key, value, &dups, &dist);
+    }
+    plk = (plk + 1 == tab->cap)?0:(plk + 1);
+    ++dist;
+  }
+
+  tab->size += 1;
+  udTableSet(tab, plk, tag, key, value);
+  tab->dups[plk] = dups;
+  tab->dist[plk] = dist;
+  if (result == tab->cap){
+    result = plk;
+  }
+  return udItemAt(tab, result);
+}
+
+static UD_ITEM udTableInsert(udTable* tab, UD_KEY key, const void* data){
+  uint32_t hash = 0;
+  uint32_t plk = 0;
+
+  UD_COUNT(tab, inserts);
+  if (tab->dist != 0){
+    return udTableInsertRobin(tab, key, data);
+  }
+
+  if (tab->size == tab->cap){ /* No space left */
+    return 0;
+  }
+
+  /* Count this item in dups of every equal key before empty bucket */
+  hash = tab->hash(key);
+  if (udProbe(tab, key, hash, hash & (tab->cap-1), tab->cap, 1, &plk) != UD_PROBE_EMPTY){
+    /* after looping didn't found empty item */
+    return 0;
+  }
+
+  tab->size += 1;
+  udTableSet(tab, plk, udTag(hash), key, data);
+  return udItemAt(tab, plk);
+}
+
+/**
+ * Find key, which hash is already computed.
+ */
+static UD_ITEM udTableFindHashed(udTable* tab, UD_KEY key, uint32_t hash){
+  uint32_t plk = 0;
+
+  UD_COUNT(tab, lookups);
+  if (tab->dist != 0){
+    if (udProbeRobin(tab, key, hash, hash & (tab->cap-1), 0, &plk) == UD_PROBE_KEY){
+      return udItemAt(tab, plk);
+    }
+    return 0;
+  }
+
+  if (udProbe(tab, key, hash, hash & (tab->cap-1), tab->cap, 0, &plk) == UD_PROBE_KEY){
+    return udItemAt(tab, plk);
+  }
+  return 0;
+}
+
+static UD_ITEM udTableFind(udTable* tab, UD_KEY key){
+  if (tab->size == 0){
+    return 0;
+  }
+  return udTableFindHashed(tab, key, tab->hash(key));
+}
+
+/**
+ * Remove item from table with backward shift.
+ *
+ * No tombstones are left: every following item of the run, which is not
+ * already at its home bucket, moves one hole back, so probe sequences
+ * stay as short as if removed item was never inserted.
+ */
+static void udTableRemove(udTable* tab, uint32_t pos){
+  UD_KEY key = *udKeyAt(tab, pos);
+  uint32_t plk = tab->hash(key) & (tab->cap-1);
+  uint32_t hole = pos;
+
+  /* Equal keys before removed one have one duplicate less */
+  while (plk != pos){
+    if ((tab->ctrl[plk] != UD_CTRL_EMPTY) && UD_KEY_EQ(*udKeyAt(tab, plk), key)){
+      --tab->dups[plk];
+    }
+    plk = (plk + 1) % tab->cap;
+  }
+
+  plk = (pos + 1) % tab->cap;
+
+  if (tab->dist != 0){
+    /* Robin Hood items are sorted by home, so shift ends at first item at home */
+    while ((plk != pos) && (tab->ctrl[plk] != UD_CTRL_EMPTY) && (tab->dist[plk] != 0)){
+      udTableMove(tab, hole, plk);
+      tab->dist[hole] -= 1;
+      hole = plk;
+      plk = (plk + 1) % tab->cap;
+    }
+  } else {
+    while ((plk != pos) && (tab->ctrl[plk] != UD_CTRL_EMPTY)){
+      uint32_t home = tab->hash(*udKeyAt(tab, plk)) & (tab->cap-1);
+      int stays = (hole < plk)
+        ?((home > hole) && (home <= plk)) /* home in (hole, plk] */
+        :((home > hole) || (home <= plk)); /* same, but wrapped */
+
+      if (!stays){
+        udTableMove(tab, hole, plk);
+        hole = plk;
+      }
+      plk = (plk + 1) % tab->cap;
+    }
+  }
+
+  udSetCtrl(tab, hole, UD_CTRL_EMPTY);
+  tab->dups[hole] = 0;
+  if (tab->dist != 0){
+    tab->dist[hole] = 0;
+  }
+  --tab->size;
+}
+
+/**
+ * Move whole run of active old buckets around pos into actual table.
+ *
+ * Probe sequence never crosses empty bucket, so when all buckets
+ * between two empty ones are gone, no old lookup is broken. Keeps all
+ * items with equal key in the same table.
+ *
+ * @return number of buckets migrated
+ */
+static uint32_t udMigrateRun(UD_DICT ud, uint32_t pos){
+  udTable* old = &ud->old;
+  uint32_t left = old->cap;
+  uint32_t moved = 0;
+
+  if (old->ctrl[pos] == UD_CTRL_EMPTY){
+    return 0;
+  }
+
+  /* Find run start */
+  while ((left-->0) && (old->ctrl[(pos + old->cap - 1) % old->cap] != UD_CTRL_EMPTY)){
+    pos = (pos + old->cap - 1) % old->cap;
+  }
+
+  /* Items are moved in probe order, so udNext order is kept */
+  while ((moved < old->cap) && (old->ctrl[pos] != UD_CTRL_EMPTY)){
+    /* No test on result, because new table is bigger than old one */
+    udTableInsert(&ud->tab, *udKeyAt(old, pos), udItemAt(old, pos));
+    udSetCtrl(old, pos, UD_CTRL_EMPTY);
+    old->dups[pos] = 0;
+    --old->size;
+    ++moved;
+    pos = (pos + 1) % old->cap;
+  }
+
+  if (old->size == 0){
+    udTableCleanup(old);
+  }
+  return moved;
+}
+
+/**
+ * Migrate about budget old buckets, finishing every started run.
+ */
+static void udMigrateStep(UD_DICT ud, uint32_t budget){
+  uint32_t done = 0;
+  while ((ud->old.size > 0) && (done < budget)){
+    done += udMigrateRun(ud, ud->cursor) + 1;
+    if (ud->old.size > 0){
+      ud->cursor = (ud->cursor + 1) % ud->old.cap;
+    }
+  }
+}
+
+/**
+ * Migrate old buckets, which can hold items with given key.
+ */
+static void udMigrateKey(UD_DICT ud, UD_KEY key){
+  if (ud->old.size > 0){
+    udMigrateRun(ud, ud->old.hash(key) & (ud->old.cap - 1));
+  }
+}
+
+/**
+ * Start UD_INCREMENTAL table growth, when one more item would exceed load limit.
+ */
+static void udGrow(UD_DICT ud){
+  udTable ntab;
+
+  if ((ud->flags & UD_INCREMENTAL) == 0){
+    return;
+  }
+
+  if (ud->tab.size + 1 <= UD_LOAD_LIMIT(ud->tab.cap)){
+    return;
+  }
+
+  /* Previous growth still not finished, so finish it now */
+  udMigrateStep(ud, UINT32_MAX);
+
+  if (udTableInit(&ntab, ud->tab.cap << 1, ud->flags, ud->tab.hash, ud->tab.vsize) != 0){
+    /* Keep working with old table, while there is space left */
+    return;
+  }
+
+  ud->old = ud->tab;
+  ud->tab = ntab;
+  ud->cursor = 0;
+  UD_COUNTERS_ATTACH(ud, &ud->tab);
+  UD_COUNT(&ud->tab, rehashes);
+}
+
+UD_DICT UD_FN(Init)(uint32_t icap){
+  return UD_FN(InitEx)(icap, UD_DEFAULT);
+}
+
+/**
+ * Create table with values of given size.
+ */
+static UD_DICT udInitSized(uint32_t icap, uint32_t flags, uint32_t vsize){
+  UD_DICT result = 0;
+  uint32_t cap = 1;
+
+  if ((icap == 0) || (icap > 0x80000000u)){
+    return 0;
+  }
+
+  /* Home bucket is masked hash, so every bucket must be reachable */
+  while (cap < icap){
+    cap <<= 1;
+  }
+  icap = cap;
+
+  result = (UD_DICT)calloc(1, sizeof(UD_DICT_STRUCT));
+  if (result == 0){
+    return 0;
+  }
+
+  if (udTableInit(&result->tab, icap, flags, UD_HASH_DEFAULT, vsize) != 0){
+    free(result);
+    return 0;
+  }
+
+  UD_COUNTERS_ATTACH(result, &result->tab);
+  result->flags = flags;
+  return result;
+}
+
+UD_DICT UD_FN(InitEx)(uint32_t icap, uint32_t flags){
+  return udInitSized(icap, flags, sizeof(void*));
+}
+
+UD_DICT UD_FN(InitInline)(uint32_t icap, uint32_t flags, uint32_t vsize){
+  if ((vsize == 0) || (vsize > UD_INLINE_MAX)){
+    return 0;
+  }
+  return udInitSized(icap, flags | UD_INLINE, vsize);
+}
+
+/**
+ * Insert item with value bytes at data.
+ */
+static UD_ITEM udInsertData(UD_DICT ud, UD_KEY key, const void* data){
+  if ((ud->flags & UD_READONLY) != 0){
+    return 0;
+  }
+  if (ud->old.size > 0){
+    udMigrateStep(ud, UD_MIGRATE_STEP);
+  }
+  udGrow(ud);
+  udMigrateKey(ud, key);
+  return udTableInsert(&ud->tab, key, data);
+}
+
+UD_HASH_FUNC UD_FN(SetHashFunc)(UD_DICT ud, UD_HASH_FUNC func){
+  UD_HASH_FUNC result = 0;
+
+  if ((ud == 0) || (func == 0) || (UD_FN(Size)(ud) != 0) || ((ud->flags & UD_READONLY) != 0)){
+    return 0;
+  }
+
+  result = ud->tab.hash;
+  ud->tab.hash = func;
+  return result;
+}
+
+UD_DICT UD_FN(Rehash)(UD_DICT* old, uint32_t icap){
+  UD_DICT nhash = 0;
+  uint32_t flags = UD_DEFAULT;
+  uint32_t vsize = sizeof(void*);
+
+  if ((old != 0) && (*old != 0)){
+    if (icap < UD_FN(Cap)(*old)){
+      return 0;
+    }
+    flags = (*old)->flags & ~UD_READONLY;
+    vsize = (*old)->tab.vsize;
+  }
+  nhash = udInitSized(icap, flags, vsize);
+
+  if (nhash == 0){
+    return 0;
+  }
+
+  if ((old != 0) && (*old != 0)){
+    UD_ITEM item = 0;
+
+    UD_FN(SetHashFunc)(nhash, (*old)->tab.hash);
+    UD_COUNT(&nhash->tab, rehashes);
+
+    /* Actual rehashing */
+    item = UD_FN(IterFirst)(*old);
+    while (item != 0){
+      /* No test on udInsert result, because everything must fit */
+      udInsertData(nhash, UD_FN(ItemKey)(*old, item), item);
+      item = UD_FN(IterNext)(*old, item);
+    }
+
+    UD_FN(Cleanup)(old);
+  }
+
+  return nhash;
+
+}
+
+void UD_FN(Cleanup)(UD_DICT* ud){
+  UD_FN(CleanupDeep)(ud, 0);
+}
+
+static void udTableCleanupDeep(const udTable* tab, UD_CLEANUP_FUNC func){
+  uint32_t left = tab->size;
+  uint32_t word = 0;
+  /* Table is not changed, it may be mapped read-only */
+  while((left > 0) && (word < UD_OCC_WORDS(tab->cap))) {
+    uint64_t bits = tab->occ[word];
+    while (bits != 0) {
+      func(udItemAt(tab, (word << 6) + udWordFirst(bits)));
+      bits &= bits - 1;
+      --left;
+    }
+    ++word;
+  }
+}
+
+void UD_FN(CleanupDeep)(UD_DICT* ud, UD_CLEANUP_FUNC func){
+  if (ud != 0){
+    if (*ud != 0){
+
+      if (func != 0) {
+        udTableCleanupDeep(&(*ud)->tab, func);
+        udTableCleanupDeep(&(*ud)->old, func);
+      }
+
+#ifdef UD_HAS_MMAP
+      if ((*ud)->map != 0){
+        munmap((*ud)->map, (*ud)->mapSize);
+        memset(&(*ud)->tab, 0, sizeof(udTable));
+      }
+#endif
+      udTableCleanup(&(*ud)->tab);
+      udTableCleanup(&(*ud)->old);
+      free(*ud);
+      *ud = 0;
+    }
+  }
+}
+
+uint32_t UD_FN(Size)(const UD_DICT ud){
+  if (ud == 0){
+    return 0;
+  }
+  return ud->tab.size + ud->old.size;
+}
+
+uint32_t UD_FN(Cap)(const UD_DICT ud){
+  if (ud == 0){
+    return 0;
+  }
+  return ud->tab.cap;
+}
+
+UD_ITEM UD_FN(Insert)(UD_DICT ud, UD_KEY key, void* data){
+  return udInsertData(ud, key, ((ud->flags & UD_INLINE) != 0)?data:(void*)&data);
+}
+
+/**
+ * @todo Add test for insertion of new pair when capacity reached.
+ */
+UD_ITEM UD_FN(Reset)(UD_DICT ud, UD_KEY key, void* data){
+  const void* value = ((ud->flags & UD_INLINE) != 0)?data:(void*)&data;
+  UD_ITEM item = 0;
+
+  if ((ud->flags & UD_READONLY) != 0){
+    return 0;
+  }
+
+  if (ud->old.size > 0){
+    udMigrateStep(ud, UD_MIGRATE_STEP);
+    udMigrateKey(ud, key);
+  }
+
+  item = udTableFind(&ud->tab, key);
+  if (item != 0){
+    udValueCopy(&ud->tab, item, value);
+    return item;
+  }
+
+  /* Key is new, so table may need to grow before insertion */
+  udGrow(ud);
+  return udTableInsert(&ud->tab, key, value);
+}
+
+uint32_t UD_FN(Remove)(UD_DICT ud, UD_KEY key){
+  UD_ITEM item = 0;
+  uint32_t result = 0;
+
+  if ((ud == 0) || ((ud->flags & UD_READONLY) != 0)){
+    return 0;
+  }
+
+  if (ud->old.size > 0){
+    udMigrateStep(ud, UD_MIGRATE_STEP);
+    udMigrateKey(ud, key);
+  }
+
+  /* Always remove first one, so no equal keys before it */
+  while ((item = udTableFind(&ud->tab, key)) != 0){
+    udTableRemove(&ud->tab, udItemPos(&ud->tab, item));
+    ++result;
+  }
+  return result;
+}
+
+int UD_FN(RemoveItem)(UD_DICT ud, UD_ITEM item){
+  udTable* tab = 0;
+
+  if ((ud == 0) || (item == 0) || ((ud->flags & UD_READONLY) != 0)){
+    return -1;
+  }
+
+  if (udTableHas(&ud->tab, item)){
+    tab = &ud->tab;
+  } else if (udTableHas(&ud->old, item)){
+    tab = &ud->old;
+  } else {
+    return -1;
+  }
+
+  if (tab->ctrl[udItemPos(tab, item)] == UD_CTRL_EMPTY){
+    return -1;
+  }
+
+  udTableRemove(tab, udItemPos(tab, item));
+  if ((tab == &ud->old) && (tab->size == 0)){
+    udTableCleanup(tab);
+  }
+  return 0;
+}
+
+UD_ITEM UD_FN(Find)(const UD_DICT ud, UD_KEY key){
+  UD_ITEM result = 0;
+
+  if (ud == 0) {
+    return 0;
+  }
+
+  /* Lookups never migrate, so const table is never modified */
+  if (ud->old.size > 0){
+    result = udTableFind(&ud->old, key);
+    if (result != 0){
+      return result;
+    }
+  }
+
+  return udTableFind(&ud->tab, key);
+}
+
+size_t UD_FN(FindBatch)(const UD_DICT ud, const UD_KEY* keys, size_t n, UD_ITEM* out){
+  size_t result = 0;
+  size_t start = 0;
+  size_t ind = 0;
+
+  if ((ud == 0) || (keys == 0) || (out == 0)){
+    return 0;
+  }
+
+  if (ud->old.size > 0){
+    /* Two tables to look at, so nothing to win here */
+    for (ind = 0; ind < n; ++ind){
+      out[ind] = UD_FN(Find)(ud, keys[ind]);
+      result += (out[ind] != 0);
+    }
+    return result;
+  }
+
+  for (start = 0; start < n; start += UD_BATCH_BLOCK){
+    size_t end = (n - start < UD_BATCH_BLOCK)?n:(start + UD_BATCH_BLOCK);
+    uint32_t hashes[UD_BATCH_BLOCK];
+    uint32_t plks[UD_BATCH_BLOCK];
+    uint32_t lefts[UD_BATCH_BLOCK];
+    size_t active[UD_BATCH_BLOCK];
+    size_t count = 0;
+
+    /* First hash whole block and issue loads of home buckets... */
+    for (ind = start; ind < end; ++ind){
+      size_t k = ind - start;
+      hashes[k] = ud->tab.hash(keys[ind]);
+      plks[k] = hashes[k] & (ud->tab.cap-1);
+      lefts[k] = ud->tab.cap;
+      out[ind] = 0;
+      udPrefetch(ud->tab.ctrl + plks[k]);
+      udPrefetch(udKeyAt(&ud->tab, plks[k]));
+    }
+
+    if (ud->tab.size == 0){
+      continue;
+    }
+    if (ud->tab.dist != 0){
+      /* Robin Hood probes bucket by bucket, so only hashing is shared */
+      for (ind = start; ind < end; ++ind){
+        out[ind] = udTableFindHashed(&ud->tab, keys[ind], hashes[ind - start]);
+        result += (out[ind] != 0);
+      }
+      continue;
+    }
+
+    /*
+     * ...then move every unresolved key by one group per round, so
+     * misses of long probe sequences overlap too
+     */
+    for (ind = start; ind < end; ++ind){
+      UD_COUNT(&ud->tab, lookups);
+      active[count++] = ind - start;
+    }
+    while (count > 0){
+      size_t next = 0;
+      size_t i = 0;
+      for (i = 0; i < count; ++i){
+        size_t k = active[i];
+        uint32_t pos = 0;
+        int found = udProbeGroup(&ud->tab, keys[start + k], udTag(hashes[k]), plks + k, lefts + k, 0, &pos);
+        if (found == UD_PROBE_KEY){
+          out[start + k] = udItemAt(&ud->tab, pos);
+          ++result;
+        } else if ((found == UD_PROBE_NONE) && (lefts[k] > 0)){
+          udPrefetch(ud->tab.ctrl + plks[k]);
+          udPrefetch(udKeyAt(&ud->tab, plks[k]));
+          active[next++] = k;
+        }
+      }
+      count = next;
+    }
+  }
+  return result;
+}
+
+void* UD_FN(Get)(const UD_DICT ud, UD_KEY key){
+  UD_ITEM it = UD_FN(Find)(ud, key);
+  if (it != 0){
+    if ((ud->flags & UD_INLINE) != 0){
+      return UD_FN(ValuePtr)(it);
+    }
+    return UD_FN(Value)(it);
+  }
+  return 0;
+}
+
+UD_KEY UD_FN(Key)(const UD_ITEM item){
+  /* Key offset as udTableLayout places it, struct padding may differ on ILP32 */
+  return *(const UD_KEY*)((const char*)item + udValueSpace(sizeof(void*)));
+}
+
+UD_KEY UD_FN(ItemKey)(const UD_DICT ud, const UD_ITEM item){
+  const udTable* tab = udTableHas(&ud->tab, item)?(&ud->tab):(&ud->old);
+  return *udKeyAt(tab, udItemPos(tab, item));
+}
+
+void* UD_FN(Value)(const UD_ITEM item){
+  return item->value;
+}
+
+void UD_FN(SetValue)(UD_ITEM item, void* value) {
+  item->value = value;
+}
+
+void* UD_FN(ValuePtr)(const UD_ITEM item){
+  return (void*) item;
+}
+
+UD_ITEM UD_FN(Next)(UD_DICT ud, UD_ITEM item){
+  udTable* tab = udTableHas(&ud->tab, item)?(&ud->tab):(&ud->old);
+  uint32_t pos = udItemPos(tab, item);
+  UD_KEY key = *udKeyAt(tab, pos);
+  uint32_t hash = tab->hash(key);
+  uint32_t plk = pos + 1; /* Next item after this */
+
+  if (tab->dups[pos] == 0){
+    return 0;
+  }
+
+  if (plk == tab->cap){ /* Hit capacity, rewind */
+    plk = 0;
+  }
+
+  if (tab->dist != 0){
+    if (udProbeRobin(tab, key, hash, plk, tab->dist[pos] + 1, &plk) == UD_PROBE_KEY){
+      return udItemAt(tab, plk);
+    }
+    return 0;
+  }
+
+  if (udProbe(tab, key, hash, plk, tab->cap - 1, 0, &plk) == UD_PROBE_KEY){
+    return udItemAt(tab, plk);
+  }
+  return 0;
+}
+
+uint32_t UD_FN(Left)(UD_DICT ud, UD_ITEM item){
+  udTable* tab = udTableHas(&ud->tab, item)?(&ud->tab):(&ud->old);
+  return tab->dups[udItemPos(tab, item)];
+}
+
+/**
+ * Get first active item starting from index.
+ *
+ * Skips 64 empty buckets at time with occupancy bitmap.
+ */
+static UD_ITEM udTableIter(const udTable* tab, uint32_t index) {
+    uint32_t word = index >> 6;
+    uint64_t bits = 0;
+
+    if (index >= tab->cap) {
+        return 0;
+    }
+
+    bits = tab->occ[word] & (~0ull << (index & 63));
+    while (bits == 0) {
+        if (++word >= UD_OCC_WORDS(tab->cap)) {
+            return 0;
+        }
+        bits = tab->occ[word];
+    }
+    return udItemAt(tab, (word << 6) + udWordFirst(bits));
+}
+
+UD_ITEM UD_FN(IterFirst)(UD_DICT ud) {
+    UD_ITEM result = 0;
+
+    if (ud == 0) {
+        return 0;
+    }
+
+    if (UD_FN(Size)(ud) == 0) {
+        return 0;
+    }
+
+    result = udTableIter(&ud->tab, 0);
+    if (result == 0) {
+        result = udTableIter(&ud->old, 0);
+    }
+    return result;
+}
+
+UD_ITEM UD_FN(IterNext)(UD_DICT ud, UD_ITEM item) {
+    if ((ud == 0) || (item == 0)) {
+        return 0;
+    }
+
+    /* Actual table first, than the one being migrated */
+    if (udTableHas(&ud->tab, item)) {
+        UD_ITEM result = udTableIter(&ud->tab, udItemPos(&ud->tab, item) + 1);
+        if (result == 0) {
+            result = udTableIter(&ud->old, 0);
+        }
+        return result;
+    }
+    if (udTableHas(&ud->old, item)) {
+        return udTableIter(&ud->old, udItemPos(&ud->old, item) + 1);
+    }
+    return 0;
+}
+
+UD_ITEM UD_FN(IterLast)(UD_DICT ud) {
+    const udTable* tab = 0;
+    uint32_t word = 0;
+
+    if (ud == 0) {
+        return 0;
+    }
+
+    tab = (ud->old.size > 0)?(&ud->old):(&ud->tab);
+
+    for (word = UD_OCC_WORDS(tab->cap); word > 0; --word) {
+        if (tab->occ[word - 1] != 0) {
+            return udItemAt(tab, ((word - 1) << 6) + udWordLast(tab->occ[word - 1]));
+        }
+    }
+    return 0;
+}
+
+
+/**
+ * udBuildBulk worker state.
+ */
+typedef struct _udict_bulk_job_ {
+  udTable* tab; /**< Table being built */
+  const UD_KEY* keys; /**< Input keys */
+  void* const* values; /**< Input values, may be zero */
+  uint32_t* hashes; /**< Key hashes */
+  uint32_t* order; /**< Item indices grouped by region, then deferred items of region */
+  size_t* counts; /**< Items of input chunk in every region, then their positions in order */
+  size_t first; /**< Input chunk start */
+  size_t last; /**< Input chunk end */
+  size_t ofirst; /**< Region items start in order */
+  size_t olast; /**< Region items end in order */
+  size_t deferred; /**< Number of region items, which did not fit in region */
+  uint32_t regions; /**< Number of regions */
+  uint32_t shift; /**< Bucket index shift giving region */
+  uint32_t lo; /**< First region bucket */
+  uint32_t hi; /**< Region end bucket */
+} udBulkJob;
+
+typedef void* (*udBulkFunc)(void* job);
+
+/**
+ * Call func for every job, each one in its own thread.
+ */
+static void udBulkRun(udBulkJob* jobs, uint32_t count, udBulkFunc func){
+  pthread_t threads[UD_BULK_MAX_THREADS];
+  int started[UD_BULK_MAX_THREADS];
+  uint32_t i = 0;
+
+  for (i = 1; i < count; ++i){
+    started[i] = pthread_create(threads + i, 0, func, jobs + i) == 0;
+    if (!started[i]){ /* Do it ourselves */
+      func(jobs + i);
+    }
+  }
+  func(jobs);
+  for (i = 1; i < count; ++i){
+    if (started[i]){
+      pthread_join(threads[i], 0);
+    }
+  }
+}
+
+/**
+ * Hash input chunk and count its items in every region.
+ */
+static void* udBulkHash(void* arg){
+  udBulkJob* job = (udBulkJob*) arg;
+  size_t i = 0;
+  memset(job->counts, 0, job->regions*sizeof(size_t));
+  for (i = job->first; i < job->last; ++i){
+    job->hashes[i] = job->tab->hash(job->keys[i]);
+    ++job->counts[(job->hashes[i] & (job->tab->cap - 1)) >> job->shift];
+  }
+  return 0;
+}
+
+/**
+ * Scatter input chunk indices to their regions, keeping input order.
+ */
+static void* udBulkScatter(void* arg){
+  udBulkJob* job = (udBulkJob*) arg;
+  size_t i = 0;
+  for (i = job->first; i < job->last; ++i){
+    job->order[job->counts[(job->hashes[i] & (job->tab->cap - 1)) >> job->shift]++] = (uint32_t) i;
+  }
+  return 0;
+}
+
+/**
+ * Place region items inside region, defer ones reaching region end.
+ */
+static void* udBulkFill(void* arg){
+  udBulkJob* job = (udBulkJob*) arg;
+  udTable* tab = job->tab;
+  size_t i = 0;
+
+  job->deferred = 0;
+  for (i = job->ofirst; i < job->olast; ++i){
+    uint32_t item = job->order[i];
+    uint32_t plk = job->hashes[item] & (tab->cap - 1);
+
+    while ((plk < job->hi) && (tab->ctrl[plk] != UD_CTRL_EMPTY)){
+      ++plk;
+    }
+    if (plk == job->hi){
+      /* Deferred items are never ahead of read position */
+      job->order[job->ofirst + job->deferred++] = item;
+      continue;
+    }
+    udTableSet(tab, plk, udTag(job->hashes[item]), job->keys[item],
+      (job->values != 0)?(const void*)(job->values + item):0);
+  }
+  return 0;
+}
+
+/**
+ * Count duplicates for every run starting in region.
+ *
+ * Equal keys share run, so every item is handled by exactly one job.
+ */
+static void* udBulkDups(void* arg){
+  udBulkJob* job = (udBulkJob*) arg;
+  udTable* tab = job->tab;
+  uint32_t mask = tab->cap - 1;
+  size_t pos = job->lo;
+
+  /* Skip run started in previous region */
+  if (tab->ctrl[(job->lo - 1) & mask] != UD_CTRL_EMPTY){
+    while (tab->ctrl[pos & mask] != UD_CTRL_EMPTY){
+      ++pos;
+    }
+  }
+
+  while (pos < job->hi){
+    size_t start = pos;
+    size_t cur = 0;
+
+    if (tab->ctrl[pos & mask] == UD_CTRL_EMPTY){
+      ++pos;
+      continue;
+    }
+    while (tab->ctrl[pos & mask] != UD_CTRL_EMPTY){
+      ++pos;
+    }
+
+    /* Walk run backward, so next equal key already knows its dups */
+    for (cur = pos; cur-- > start;){
+      uint32_t ind = (uint32_t)(cur & mask);
+      UD_KEY key = *udKeyAt(tab, ind);
+      uint32_t next = 0;
+      if ((cur + 1 < pos)
+        && (udProbe(tab, key, tab->hash(key), (ind + 1) & mask, (uint32_t)(pos - cur - 1), 0, &next) == UD_PROBE_KEY)){
+        tab->dups[ind] = tab->dups[next] + 1;
+      }
+    }
+  }
+  return 0;
+}
+
+UD_DICT UD_FN(BuildBulk)(const UD_KEY* keys, void* const* values, size_t n, uint32_t threads){
+  udBulkJob jobs[UD_BULK_MAX_THREADS];
+  UD_DICT result = 0;
+  udTable* tab = 0;
+  uint32_t* hashes = 0;
+  uint32_t* order = 0;
+  size_t* counts = 0;
+  uint32_t cap = 1;
+  uint32_t regions = 1;
+  uint32_t shift = 0;
+  uint32_t t = 0;
+  uint32_t r = 0;
+  size_t offset = 0;
+
+  if ((keys == 0) && (n != 0)){
+    return 0;
+  }
+  if (n > UD_LOAD_LIMIT((size_t)0x80000000u)){
+    return 0;
+  }
+
+  /* Table is sized once, with the same load limit as UD_INCREMENTAL growth */
+  while ((UD_LOAD_LIMIT((size_t)cap) < n) || (cap <= n)){
+    cap <<= 1;
+  }
+
+  result = udInitSized(cap, UD_INCREMENTAL, sizeof(void*));
+  if ((result == 0) || (n == 0)){
+    return result;
+  }
+  tab = &result->tab;
+
+  /* Regions are power of two and at least 64 buckets, so they never share bitmap word */
+  threads = (threads < 1)?1:((threads > UD_BULK_MAX_THREADS)?UD_BULK_MAX_THREADS:threads);
+  while ((regions*2 <= threads) && ((cap/(regions*2)) >= 64)){
+    regions *= 2;
+  }
+  while ((cap >> shift) > regions){
+    ++shift;
+  }
+
+  hashes = (uint32_t*) malloc(n*sizeof(uint32_t));
+  order = (uint32_t*) malloc(n*sizeof(uint32_t));
+  counts = (size_t*) malloc((size_t)regions*regions*sizeof(size_t));
+  if ((hashes == 0) || (order == 0) || (counts == 0)){
+    free(hashes);
+    free(order);
+    free(counts);
+    UD_FN(Cleanup)(&result);
+    return 0;
+  }
+
+  for (t = 0; t < regions; ++t){
+    memset(jobs + t, 0, sizeof(udBulkJob));
+    jobs[t].tab = tab;
+    jobs[t].keys = keys;
+    jobs[t].values = values;
+    jobs[t].hashes = hashes;
+    jobs[t].order = order;
+    jobs[t].counts = counts + (size_t)t*regions;
+    jobs[t].first = n*t/regions;
+    jobs[t].last = n*(t + 1)/regions;
+    jobs[t].regions = regions;
+    jobs[t].shift = shift;
+    jobs[t].lo = t << shift;
+    jobs[t].hi = (t + 1) << shift;
+  }
+
+  udBulkRun(jobs, regions, udBulkHash);
+
+  /* Region r items of chunk t go after region r items of every earlier chunk */
+  for (r = 0; r < regions; ++r){
+    jobs[r].ofirst = offset;
+    for (t = 0; t < regions; ++t){
+      size_t count = jobs[t].counts[r];
+      jobs[t].counts[r] = offset;
+      offset += count;
+    }
+    jobs[r].olast = offset;
+  }
+
+  udBulkRun(jobs, regions, udBulkScatter);
+  udBulkRun(jobs, regions, udBulkFill);
+
+  /* Deferred items spill over region end, so they go one by one */
+  for (r = 0; r < regions; ++r){
+    size_t i = 0;
+    for (i = 0; i < jobs[r].deferred; ++i){
+      uint32_t item = order[jobs[r].ofirst + i];
+      uint32_t plk = hashes[item] & (cap - 1);
+      while (tab->ctrl[plk] != UD_CTRL_EMPTY){
+        plk = (plk + 1) & (cap - 1);
+      }
+      udTableSet(tab, plk, udTag(hashes[item]), keys[item],
+        (values != 0)?(const void*)(values + item):0);
+    }
+  }
+
+  tab->size = (uint32_t) n;
+  udBulkRun(jobs, regions, udBulkDups);
+
+  free(hashes);
+  free(order);
+  free(counts);
+  return result;
+}
+
+/**
+ * Add run of active buckets to statistics.
+ */
+static void udStatsRun(udStats_t* stats, uint32_t run){
+  uint32_t bucket = 0;
+  while ((bucket + 1 < UD_STATS_BUCKETS) && ((run >> (bucket + 1)) != 0)){
+    ++bucket;
+  }
+  ++stats->cluster[bucket];
+  ++stats->clusters;
+  if (run > stats->maxCluster){
+    stats->maxCluster = run;
+  }
+}
+
+/**
+ * Add table buckets to statistics.
+ */
+static void udTableStats(const udTable* tab, udStats_t* stats, uint64_t* probeSum){
+  uint32_t mask = tab->cap - 1;
+  uint32_t empty = 0;
+  uint32_t run = 0;
+  uint32_t i = 0;
+
+  if (tab->size == 0){
+    return;
+  }
+
+  for (i = 0; i < tab->cap; ++i){
+    uint32_t home = 0;
+    uint32_t dist = 0;
+
+    if (tab->ctrl[i] == UD_CTRL_EMPTY){
+      continue;
+    }
+
+    home = tab->hash(*udKeyAt(tab, i)) & mask;
+    dist = (i - home) & mask;
+    ++stats->probe[(dist < UD_STATS_BUCKETS)?dist:(UD_STATS_BUCKETS - 1)];
+    *probeSum += dist;
+    if (dist > stats->maxProbe){
+      stats->maxProbe = dist;
+    }
+    if (i < home){
+      ++stats->wrapped;
+    }
+
+    /* Every chain of two or more equal keys has single item with one duplicate left */
+    if (tab->dups[i] == 1){
+      ++stats->dupKeys;
+      ++stats->dupItems;
+    }
+    if (tab->dups[i] > 0){
+      ++stats->dupItems;
+    }
+    if (tab->dups[i] + 1 > stats->maxDupChain){
+      stats->maxDupChain = tab->dups[i] + 1;
+    }
+  }
+
+  /* Start after empty bucket, so run wrapping around table end is counted once */
+  while ((empty < tab->cap) && (tab->ctrl[empty] != UD_CTRL_EMPTY)){
+    ++empty;
+  }
+  if (empty == tab->cap){ /* No empty bucket at all */
+    udStatsRun(stats, tab->cap);
+    return;
+  }
+  for (i = 1; i <= tab->cap; ++i){
+    if ((i < tab->cap) && (tab->ctrl[(empty + i) & mask] != UD_CTRL_EMPTY)){
+      ++run;
+      continue;
+    }
+    if (run > 0){
+      udStatsRun(stats, run);
+      run = 0;
+    }
+  }
+}
+
+int UD_FN(Stats)(const UD_DICT ud, udStats_t* stats){
+  uint64_t probeSum = 0;
+
+  if ((ud == 0) || (stats == 0)){
+    return -1;
+  }
+
+  memset(stats, 0, sizeof(udStats_t));
+  stats->size = UD_FN(Size)(ud);
+  stats->cap = ud->tab.cap;
+
+  udTableStats(&ud->tab, stats, &probeSum);
+  udTableStats(&ud->old, stats, &probeSum);
+
+  if (stats->size > 0){
+    stats->meanProbe = (double) probeSum/stats->size;
+    stats->meanCluster = (double) stats->size/stats->clusters;
+  }
+
+#ifdef UD_STATS_COUNTERS
+  stats->counters = 1;
+  stats->lookups = UD_COUNTER_LOAD(ud->counters.lookups);
+  stats->probes = UD_COUNTER_LOAD(ud->counters.probes);
+  stats->inserts = UD_COUNTER_LOAD(ud->counters.inserts);
+  stats->rehashes = UD_COUNTER_LOAD(ud->counters.rehashes);
+  stats->wraps = UD_COUNTER_LOAD(ud->counters.wraps);
+#endif
+  return 0;
+}
+
+int UD_FN(Save)(UD_DICT ud, const char* path){
+  udFileHeader head;
+  FILE* output = 0;
+  int result = 0;
+
+  if ((ud == 0) || (path == 0)){
+    return -1;
+  }
+
+  memset(&head, 0, sizeof(udFileHeader));
+  if (ud->tab.hash == UD_HASH_DEFAULT){
+    head.hash = UD_FILE_HASH_MIX;
+  } else if (ud->tab.hash == UD_HASH_IDENTITY){
+    head.hash = UD_FILE_HASH_IDENTITY;
+  } else { /* Function pointer means nothing in other process */
+    return -1;
+  }
+
+  /* File holds single table */
+  if (ud->old.size > 0){
+    udMigrateStep(ud, UINT32_MAX);
+  }
+
+  memcpy(head.magic, "UDICTMAP", sizeof(head.magic));
+  head.version = UD_FILE_VERSION;
+  head.order = UD_FILE_ORDER;
+  head.keySize = sizeof(UD_KEY);
+  head.ptrSize = sizeof(void*);
+  head.groupWidth = UD_GROUP_WIDTH;
+  head.flags = ud->flags & ~UD_READONLY;
+  head.cap = ud->tab.cap;
+  head.size = ud->tab.size;
+  head.vsize = ud->tab.vsize;
+  head.bytes = udTableBytes(ud->tab.cap, ud->flags, ud->tab.vsize);
+
+  output = fopen(path, "wb");
+  if (output == 0){
+    return -1;
+  }
+
+  if ((fwrite(&head, sizeof(udFileHeader), 1, output) != 1)
+    || (fwrite(ud->tab.occ, (size_t) head.bytes, 1, output) != 1)){
+    result = -1;
+  }
+
+  if (fclose(output) != 0){
+    result = -1;
+  }
+  return result;
+}
+
+UD_DICT UD_FN(MapFile)(const char* path){
+#ifdef UD_HAS_MMAP
+  const udFileHeader* head = 0;
+  UD_DICT result = 0;
+  struct stat info;
+  char* map = 0;
+  int fd = -1;
+
+  if (path == 0){
+    return 0;
+  }
+
+  fd = open(path, O_RDONLY);
+  if (fd < 0){
+    return 0;
+  }
+
+  if ((fstat(fd, &info) != 0) || ((size_t) info.st_size < sizeof(udFileHeader))){
+    close(fd);
+    return 0;
+  }
+
+  /* Shared read-only pages, so every process mapping file uses the same memory */
+  map = (char*) mmap(0, (size_t) info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (map == (char*) MAP_FAILED){
+    return 0;
+  }
+
+  head = (const udFileHeader*) map;
+  if ((memcmp(head->magic, "UDICTMAP", sizeof(head->magic)) != 0)
+    || (head->version != UD_FILE_VERSION)
+    || (head->order != UD_FILE_ORDER)
+    || (head->keySize != sizeof(UD_KEY))
+    || (head->ptrSize != sizeof(void*))
+    || (head->groupWidth < UD_GROUP_WIDTH)
+    || ((head->hash != UD_FILE_HASH_MIX) && (head->hash != UD_FILE_HASH_IDENTITY))
+    || (head->cap == 0) || ((head->cap & (head->cap - 1)) != 0)
+    || (head->size > head->cap)
+    || (head->vsize == 0) || (head->vsize > UD_INLINE_MAX)
+    || (((head->flags & UD_INLINE) == 0) && (head->vsize != sizeof(void*)))
+    || (head->bytes < udTableBytes(head->cap, head->flags, head->vsize))
+    || (head->bytes > (uint64_t) info.st_size - sizeof(udFileHeader))){
+    munmap(map, (size_t) info.st_size);
+    return 0;
+  }
+
+  result = (UD_DICT)calloc(1, sizeof(UD_DICT_STRUCT));
+  if (result == 0){
+    munmap(map, (size_t) info.st_size);
+    return 0;
+  }
+
+  udTableLayout(&result->tab, map + sizeof(udFileHeader), head->cap, head->flags,
+    (head->hash == UD_FILE_HASH_MIX)?UD_HASH_DEFAULT:UD_HASH_IDENTITY, head->vsize);
+  result->tab.size = head->size;
+  UD_COUNTERS_ATTACH(result, &result->tab);
+  result->flags = head->flags | UD_READONLY;
+  result->map = map;
+  result->mapSize = (size_t) info.st_size;
+  return result;
+#else
+  (void) path;
+  return 0;
+#endif
+}
+
+#undef UD_KEY
+#undef UD_KEY_EQ
+#undef UD_DICT
+#undef UD_ITEM
+#undef UD_DICT_STRUCT
+#undef UD_ITEM_STRUCT
+#undef UD_HASH_FUNC
+#undef UD_CLEANUP_FUNC
+#undef UD_HASH_DEFAULT
+#undef UD_HASH_IDENTITY
+#undef UD_FN
@@ -0,0 +1,251 @@
+/**
+ * @file udpriv.h
+ * @author masscry
+ *
+ * UDICT control byte group matching and helpers shared by every key width.
+ *
+ */
+
+#pragma once
+#ifndef __UDICT_PRIVATE_HEADER__
+#define __UDICT_PRIVATE_HEADER__
+
+#include <stdint.h>
+#include <udict.h>
+
+#ifdef _MSC_VER
+#define INLINE
+#else
+#define INLINE inline
+#endif
+
+/*
+ * Every bucket has one control byte:
+ *
+ *  - 0x00 means bucket is empty;
+ *  - 0x80 | h7 means bucket is active, h7 is 7 bits of key hash.
+ *
+ * So lookups compare a whole group of control bytes with wanted tag
+ * and touch data only for candidates.
+ */
+#define UD_CTRL_EMPTY (0x00)
+#define UD_CTRL_FULL  (0x80)
+
+#if defined(__AVX2__)
+
+#include <immintrin.h>
+
+#define UD_GROUP_WIDTH (32)
+
+static INLINE uint32_t udGroupMatch(const uint8_t* ctrl, uint8_t tag) {
+  __m256i grp = _mm256_loadu_si256((const __m256i*) ctrl);
+  return (uint32_t) _mm256_movemask_epi8(
+    _mm256_cmpeq_epi8(grp, _mm256_set1_epi8((char) tag))
+  );
+}
+
+#elif defined(__SSE2__) || defined(_M_X64)
+
+#include <emmintrin.h>
+
+#define UD_GROUP_WIDTH (16)
+
+static INLINE uint32_t udGroupMatch(const uint8_t* ctrl, uint8_t tag) {
+  __m128i grp = _mm_loadu_si128((const __m128i*) ctrl);
+  return (uint32_t) _mm_movemask_epi8(
+    _mm_cmpeq_epi8(grp, _mm_set1_epi8((char) tag))
+  );
+}
+
+#else
+
+#define UD_GROUP_WIDTH (16)
+
+static INLINE uint32_t udGroupMatch(const uint8_t* ctrl, uint8_t tag) {
+  uint32_t result = 0;
+  uint32_t i = 0;
+  for (i = 0; i < UD_GROUP_WIDTH; ++i) {
+    result |= (uint32_t)(ctrl[i] == tag) << i;
+  }
+  return result;
+}
+
+#endif
+
+/**
+ * Index of lowest set bit in non-zero mask.
+ */
+static INLINE uint32_t udMaskFirst(uint32_t mask) {
+#if defined(__GNUC__) || defined(__clang__)
+  return (uint32_t) __builtin_ctz(mask);
+#else
+  uint32_t result = 0;
+  while ((mask & 1) == 0) {
+    mask >>= 1;
+    ++result;
+  }
+  return result;
+#endif
+}
+
+/**
+ * Index of lowest set bit in non-zero bitmap word.
+ */
+static INLINE uint32_t udWordFirst(uint64_t word) {
+#if defined(__GNUC__) || defined(__clang__)
+  return (uint32_t) __builtin_ctzll(word);
+#else
+  uint32_t result = 0;
+  while ((word & 1) == 0) {
+    word >>= 1;
+    ++result;
+  }
+  return result;
+#endif
+}
+
+/**
+ * Index of highest set bit in non-zero bitmap word.
+ */
+static INLINE uint32_t udWordLast(uint64_t word) {
+#if defined(__GNUC__) || defined(__clang__)
+  return 63 - (uint32_t) __builtin_clzll(word);
+#else
+  uint32_t result = 63;
+  while ((word & 0x8000000000000000ull) == 0) {
+    word <<= 1;
+    --result;
+  }
+  return result;
+#endif
+}
+
+/**
+ * Number of 64-bit words in occupancy bitmap of table with given capacity.
+ */
+#define UD_OCC_WORDS(cap) (((cap) + 63)/64)
+
+/**
+ * Mask with lowest width bits set.
+ */
+static INLINE uint32_t udMaskWidth(uint32_t width) {
+  return (width >= 32)?(0xFFFFFFFFu):((1u << width) - 1);
+}
+
+/**
+ * Ask processor to bring memory to cache.
+ */
+static INLINE void udPrefetch(const void* ptr) {
+#if defined(__GNUC__) || defined(__clang__)
+  __builtin_prefetch(ptr);
+#else
+  (void) ptr;
+#endif
+}
+
+/**
+ * Make control byte for key hash.
+ *
+ * Home bucket uses low hash bits, so tag is taken from high bits of
+ * multiplied hash to stay independent from bucket index, even with
+ * udHashIdentity.
+ */
+static INLINE uint8_t udTag(uint32_t hash) {
+  return (uint8_t)(UD_CTRL_FULL | ((hash * 0x9E3779B1u) >> 25));
+}
+
+/**
+ * Maximum number of items in table of given capacity, before
+ * UD_INCREMENTAL table starts to grow.
+ */
+#define UD_LOAD_LIMIT(cap) ((cap) - (cap)/8)
+
+/**
+ * Number of old buckets migrated on each udInsert/udReset/udRemove
+ * in UD_INCREMENTAL mode.
+ */
+#define UD_MIGRATE_STEP (32)
+
+/**
+ * Number of keys prefetched together by udFindBatch.
+ */
+#define UD_BATCH_BLOCK (16)
+
+#ifdef UD_STATS_COUNTERS
+#include <stdatomic.h>
+
+/*
+ * Counters are bumped by udBuildBulk workers and concurrent lookups,
+ * relaxed atomics keep them exact without ordering anything else.
+ */
+typedef _Atomic uint64_t udCounter;
+
+#define UD_COUNT(tab, field) \
+  atomic_fetch_add_explicit(&(tab)->counters->field, 1, memory_order_relaxed)
+#define UD_COUNTER_LOAD(counter) atomic_load_explicit(&(counter), memory_order_relaxed)
+#define UD_COUNTERS_ATTACH(ud, tab) ((tab)->counters = &(ud)->counters)
+#else
+typedef uint64_t udCounter;
+
+#define UD_COUNT(tab, field)
+#define UD_COUNTERS_ATTACH(ud, tab)
+#endif
+
+/**
+ * Operation counters, compiled in with UD_STATS_COUNTERS.
+ */
+typedef struct _udict_counters_ {
+  udCounter lookups; /**< Table lookups */
+  udCounter probes; /**< Control byte groups, or Robin Hood buckets, tested */
+  udCounter inserts; /**< Table insertions */
+  udCounter rehashes; /**< Table growths and udRehash calls */
+  udCounter wraps; /**< Probes wrapped from last bucket to first */
+} udCounters;
+
+/**
+ * Maximum number of udBuildBulk threads.
+ */
+#define UD_BULK_MAX_THREADS (64)
+
+/**
+ * udSave file format version.
+ */
+#define UD_FILE_VERSION (1)
+
+/**
+ * Written in native byte order, to detect files from other machines.
+ */
+#define UD_FILE_ORDER (0x01020304u)
+
+/**
+ * Hashing policies, which can be saved to file.
+ */
+enum udFileHash {
+  UD_FILE_HASH_MIX = 1, /**< udHashMix of key width */
+  UD_FILE_HASH_IDENTITY = 2 /**< udHashIdentity of key width */
+};
+
+/**
+ * udSave file header, followed by table chunk as it is in memory.
+ *
+ * Header is 64 bytes, so chunk mapped after it keeps its alignment.
+ */
+typedef struct _udict_file_header_ {
+  char magic[8]; /**< "UDICTMAP" */
+  uint32_t version; /**< UD_FILE_VERSION */
+  uint32_t order; /**< UD_FILE_ORDER */
+  uint32_t keySize; /**< Key size */
+  uint32_t ptrSize; /**< Pointer size */
+  uint32_t groupWidth; /**< Number of mirrored control bytes */
+  uint32_t flags; /**< Table mode */
+  uint32_t cap; /**< Capacity */
+  uint32_t size; /**< Size */
+  uint32_t vsize; /**< Value size */
+  uint32_t hash; /**< One of udFileHash */
+  uint64_t bytes; /**< Chunk size */
+  char reserved[8]; /**< Zeros */
+} udFileHeader;
+
+typedef char udFileHeaderSizeCheck[(sizeof(udFileHeader) == 64)?1:-1];
+
+#endif /* __UDICT_PRIVATE_HEADER__ */
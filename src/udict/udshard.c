@@ -0,0 +1,182 @@
+#include <pthread.h>
+
+#include <udshard.h>
+#include "udpriv.h"
+
+/**
+ * Size of cache line, shards do not share lines.
+ */
+#define UDS_CACHE_LINE (64)
+
+/**
+ * Maximum number of shards.
+ */
+#define UDS_MAX_SHARDS (1024)
+
+/**
+ * One shard of table.
+ */
+typedef struct _udshard_part_ {
+  _Alignas(UDS_CACHE_LINE) pthread_mutex_t lock; /**< Shard lock */
+  UDICT ud; /**< Shard items */
+} udsPart;
+
+/**
+ * Internal structure of sharded hash table.
+ */
+struct _udshard_ {
+  uint32_t count; /**< Number of shards, power of two */
+  uint32_t shift; /**< Hash shift giving shard index */
+  udsPart* parts; /**< Shards */
+};
+
+/**
+ * Select shard by high hash bits, while shard UDICT uses low ones.
+ */
+static INLINE udsPart* udsRoute(const UDSHARD uds, uint32_t key){
+  if (uds->count == 1){
+    return uds->parts;
+  }
+  return uds->parts + (udHashMix(key) >> uds->shift);
+}
+
+UDSHARD udsInit(uint32_t icap, uint32_t shards){
+  UDSHARD result = 0;
+  uint32_t count = 1;
+  uint32_t shift = 32;
+  uint32_t i = 0;
+
+  if ((icap == 0) || (shards == 0) || (shards > UDS_MAX_SHARDS)){
+    return 0;
+  }
+
+  while (count < shards){
+    count <<= 1;
+    --shift;
+  }
+
+  result = (UDSHARD)calloc(1, sizeof(struct _udshard_));
+  if (result == 0){
+    return 0;
+  }
+
+  result->parts = (udsPart*)aligned_alloc(UDS_CACHE_LINE, count*sizeof(udsPart));
+  if (result->parts == 0){
+    free(result);
+    return 0;
+  }
+
+  result->count = count;
+  result->shift = shift;
+
+  icap = (icap + count - 1)/count;
+  for (i = 0; i < count; ++i){
+    result->parts[i].ud = udInitEx(icap, UD_INCREMENTAL);
+    if ((result->parts[i].ud == 0) || (pthread_mutex_init(&result->parts[i].lock, 0) != 0)){
+      udCleanup(&result->parts[i].ud);
+      result->count = i;
+      udsCleanup(&result);
+      return 0;
+    }
+  }
+  return result;
+}
+
+void udsCleanup(UDSHARD* uds){
+  uint32_t i = 0;
+  if ((uds != 0) && (*uds != 0)){
+    for (i = 0; i < (*uds)->count; ++i){
+      udCleanup(&(*uds)->parts[i].ud);
+      pthread_mutex_destroy(&(*uds)->parts[i].lock);
+    }
+    free((*uds)->parts);
+    free(*uds);
+    *uds = 0;
+  }
+}
+
+uint32_t udsSize(UDSHARD uds){
+  uint32_t result = 0;
+  uint32_t i = 0;
+
+  if (uds == 0){
+    return 0;
+  }
+
+  for (i = 0; i < uds->count; ++i){
+    pthread_mutex_lock(&uds->parts[i].lock);
+    result += udSize(uds->parts[i].ud);
+    pthread_mutex_unlock(&uds->parts[i].lock);
+  }
+  return result;
+}
+
+uint32_t udsShards(const UDSHARD uds){
+  if (uds == 0){
+    return 0;
+  }
+  return uds->count;
+}
+
+int udsInsert(UDSHARD uds, uint32_t key, void* value){
+  udsPart* part = 0;
+  int result = 0;
+
+  if (uds == 0){
+    return -1;
+  }
+
+  part = udsRoute(uds, key);
+  pthread_mutex_lock(&part->lock);
+  result = (udInsert(part->ud, key, value) != 0)?0:-1;
+  pthread_mutex_unlock(&part->lock);
+  return result;
+}
+
+int udsReset(UDSHARD uds, uint32_t key, void* value){
+  udsPart* part = 0;
+  int result = 0;
+
+  if (uds == 0){
+    return -1;
+  }
+
+  part = udsRoute(uds, key);
+  pthread_mutex_lock(&part->lock);
+  result = (udReset(part->ud, key, value) != 0)?0:-1;
+  pthread_mutex_unlock(&part->lock);
+  return result;
+}
+
+int udsFind(UDSHARD uds, uint32_t key, void** value){
+  udsPart* part = 0;
+  UDITEM item = 0;
+
+  if (uds == 0){
+    return 0;
+  }
+
+  part = udsRoute(uds, key);
+  pthread_mutex_lock(&part->lock);
+  item = udFind(part->ud, key);
+  if ((item != 0) && (value != 0)){
+    *value = udValue(item);
+  }
+  pthread_mutex_unlock(&part->lock);
+  return item != 0;
+}
+
+uint32_t udsRemove(UDSHARD uds, uint32_t key){
+  udsPart* part = 0;
+  uint32_t result = 0;
+
+  if (uds == 0){
+    return 0;
+  }
+
+  part = udsRoute(uds, key);
+  pthread_mutex_lock(&part->lock);
+  result = udRemove(part->ud, key);
+  pthread_mutex_unlock(&part->lock);
+  return result;
+}
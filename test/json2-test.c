@@ -162,6 +162,35 @@ void TestObjectPack(CuTest* tc) {
     CuAssertTrue(tc, obj == 0);
 }
 
+void TestObjectLookupInIteration(CuTest* tc) {
+    J2VAL obj = 0;
+    UDITEM iter = 0;
+    char key[32];
+    int visited = 0;
+    int count = 0;
+    int i = 0;
+
+    // Every size, so some objects are in the middle of table growth
+    for (count = 1; count < 300; ++count) {
+        obj = j2InitObject();
+        CuAssertPtrNotNull(tc, obj);
+        for (i = 0; i < count; ++i) {
+            snprintf(key, sizeof(key), "key%d", i);
+            CuAssertIntEquals(tc, 0, j2ValueObjectItemSet(obj, key, j2InitNumber(i)));
+        }
+        CuAssertIntEquals(tc, count, j2ValueObjectSize(obj));
+
+        // Lookups must not move items under iterator
+        visited = 0;
+        for (iter = j2ValueObjectIterFirst(obj); iter != 0; iter = j2ValueObjectIterNext(obj, iter)) {
+            CuAssertTrue(tc, j2ValueObjectItem(obj, j2ValueObjectIterKey(iter)) == j2ValueObjectIterValue(iter));
+            ++visited;
+        }
+        CuAssertIntEquals(tc, count, visited);
+        j2Cleanup(&obj);
+    }
+}
+
 #if _WIN32
 
 char optopt = '?';
@@ -200,6 +229,7 @@ int main(int argc, char* argv[]) {
     SUITE_ADD_TEST(suite, TestSpecialPack);
     SUITE_ADD_TEST(suite, TestArrayPack);
     SUITE_ADD_TEST(suite, TestObjectPack);
+    SUITE_ADD_TEST(suite, TestObjectLookupInIteration);
 
     suite2 = PrinterRegisterTests();
     CuSuiteAddSuite(suite, suite2);
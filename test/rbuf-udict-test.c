@@ -1,10 +1,26 @@
 #include "udict.h"
+#include "udict64.h"
+#include "udconc.h"
+#include "udshard.h"
 #include "rbuf.h"
+#include "rbspsc.h"
+#include "rbmpmc.h"
+#include "rbbytes.h"
+#include "json2.h"
+#include "rbshm.h"
+#include "rbcast.h"
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include <time.h>
 #include <inttypes.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
 
 uintptr_t expects = 0;
 
@@ -58,7 +74,7 @@ void t000(){ // Initialization tests
   EXPECT(udSize(ud) == 0); // No elements in hash table
 
   EXPECT(udCap(0) == 0); // Return 0 on zero pointer
-  EXPECT(udCap(ud) == 100); // Expect 100 elements were allocated
+  EXPECT(udCap(ud) == 128); // Expect capacity rounded up to power of two
 
   udCleanup(0); // No segfault here
 
@@ -140,15 +156,16 @@ void t001(){ // Simple inserts
 
 void t002(){ // Inserts near capacity
   UDICT ud = udInit(5);
-  for (uintptr_t key = 0; key < 5; ++key){
+  EXPECT(udCap(ud) == 8);
+  for (uintptr_t key = 0; key < 8; ++key){
     udInsert(ud, key, (void*) (key + 1));
   }
-  for (uintptr_t key = 0; key < 5; ++key){
+  for (uintptr_t key = 0; key < 8; ++key){
     EXPECT(udGet(ud, key) == (void*) (key + 1));
   }
 
   // Simple insert after cap reached must return 0
-  EXPECT(udInsert(ud, 5, (void*) 6) == 0);
+  EXPECT(udInsert(ud, 8, (void*) 9) == 0);
 
   udCleanup(&ud);
 
@@ -237,7 +254,7 @@ void t005() { // Replacing test
   udCleanup(&ud);
 
   ud = udInit(5);
-  for (uintptr_t i = 0; i < 5; ++i){
+  for (uintptr_t i = 0; i < udCap(ud); ++i){
     udReset(ud, i, (void*) (i + 10)); // Work as unique key inserter
     EXPECT(udGet(ud, i) == (void*)(i + 10));
   }
@@ -268,6 +285,2128 @@ void t006(){ // Equal key iteration
   udCleanup(&ud);
 }
 
+void t010(){ // Probing over groups of buckets
+  for (uint32_t icap = 1; icap < 80; ++icap){
+    UDICT ud = udInit(icap);
+    uint32_t cap = udCap(ud);
+
+    EXPECT(udSetHashFunc(ud, udHashIdentity) == udHashMix);
+
+    // Keys collide in first buckets, so probing wraps around table end
+    for (uint32_t i = 0; i < cap; ++i){
+      SEXPECT(udInsert(ud, (cap - 1) + i*cap*2, (void*) (uintptr_t) (i + 1)) != 0);
+    }
+    SEXPECT(udSize(ud) == cap);
+
+    for (uint32_t i = 0; i < cap; ++i){
+      SEXPECT(udGet(ud, (cap - 1) + i*cap*2) == (void*) (uintptr_t) (i + 1));
+      SEXPECT(udFind(ud, cap + i*cap*2) == 0); // Misses
+    }
+
+    udCleanup(&ud);
+  }
+
+  UDICT ud = udInit(RTESTLEN);
+  uint32_t misses = 0;
+
+  // Fill ~90% of table, then mostly miss
+  for (uint32_t i = 0; i < RTESTLEN*9/10; ++i){
+    SEXPECT(udInsert(ud, i*RTESTLEN, (void*) (uintptr_t) i) != 0);
+  }
+  for (uint32_t i = 0; i < RTESTLEN*2; ++i){
+    misses += (udFind(ud, i*RTESTLEN + 1) == 0);
+  }
+  EXPECT(misses == RTESTLEN*2);
+
+  udCleanup(&ud);
+}
+
+void t011(){ // Incremental growth
+  UDICT ud = udInitEx(4, UD_INCREMENTAL);
+  EXPECT(ud != 0);
+
+  for (uintptr_t i = 0; i < RTESTLEN; ++i){
+    SEXPECT(udInsert(ud, i, (void*) (i + 1)) != 0); // Never full
+    SEXPECT(udSize(ud) == i + 1);
+    SEXPECT(udGet(ud, i/2) == (void*) (i/2 + 1)); // Old items still here
+  }
+  EXPECT(udCap(ud) > RTESTLEN);
+
+  for (uintptr_t i = 0; i < RTESTLEN; ++i){
+    SEXPECT(udGet(ud, i) == (void*) (i + 1));
+  }
+
+  uint32_t count = 0;
+  for (UDITEM it = udIterFirst(ud); it != 0; it = udIterNext(ud, it)){
+    ++count;
+  }
+  EXPECT(count == RTESTLEN);
+
+  udCleanup(&ud);
+
+  // Equal keys stay in order, while table grows
+  ud = udInitEx(2, UD_INCREMENTAL);
+  for (uintptr_t i = 0; i < 100; ++i){
+    SEXPECT(udInsert(ud, 7, (void*) i) != 0);
+    SEXPECT(udReset(ud, (uint32_t) (i + 1000), (void*) i) != 0);
+  }
+  EXPECT(udReset(ud, 1000, (void*) 55) != 0);
+  EXPECT(udSize(ud) == 200);
+
+  UDITEM it = udFind(ud, 7);
+  for (uintptr_t i = 0; i < 100; ++i){
+    SEXPECT(it != 0);
+    SEXPECT(udValue(it) == (void*) i);
+    SEXPECT(udLeft(ud, it) == 99 - i);
+    it = udNext(ud, it);
+  }
+  EXPECT(it == 0);
+  EXPECT(udGet(ud, 1000) == (void*) 55);
+
+  udCleanup(&ud);
+
+  // Worst insert latency compared with all-or-nothing growth
+  double worstFull = 0.0;
+  double worstIncr = 0.0;
+  UDICT full = udInit(4);
+  UDICT incr = udInitEx(4, UD_INCREMENTAL);
+  for (uint32_t i = 0; i < RTESTLEN*100; ++i){
+    struct timespec start;
+    double spent;
+    uint32_t key = i*2654435761u; // Spread keys, so runs of buckets stay short
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    if (udSize(full) + 1 > udCap(full) - udCap(full)/8){ // Same load limit
+      full = udRehash(&full, udCap(full) << 1);
+    }
+    udInsert(full, key, 0);
+    spent = GetTime(&start);
+    worstFull = (spent > worstFull)?spent:worstFull;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    SEXPECT(udInsert(incr, key, 0) != 0);
+    spent = GetTime(&start);
+    worstIncr = (spent > worstIncr)?spent:worstIncr;
+  }
+  printf("worst insert: rehash %f sec, incremental %f sec\n", worstFull, worstIncr);
+  EXPECT(udSize(full) == udSize(incr));
+
+  udCleanup(&full);
+  udCleanup(&incr);
+}
+
+void t012(){ // Removal
+  UDICT ud = udInit(8);
+  udSetHashFunc(ud, udHashIdentity);
+
+  EXPECT(udRemove(0, 1) == 0); // No segfault
+  EXPECT(udRemoveItem(ud, 0) == -1);
+
+  // Run wraps around table end: 6, 7, 0, 1
+  EXPECT(udInsert(ud, 6, (void*) 1) != 0);
+  EXPECT(udInsert(ud, 14, (void*) 2) != 0);
+  EXPECT(udInsert(ud, 22, (void*) 3) != 0);
+  EXPECT(udInsert(ud, 7, (void*) 4) != 0);
+
+  EXPECT(udRemove(ud, 14) == 1);
+  EXPECT(udRemove(ud, 14) == 0);
+  EXPECT(udSize(ud) == 3);
+  EXPECT(udGet(ud, 6) == (void*) 1);
+  EXPECT(udGet(ud, 22) == (void*) 3);
+  EXPECT(udGet(ud, 7) == (void*) 4);
+
+  EXPECT(udRemoveItem(ud, udFind(ud, 6)) == 0);
+  EXPECT(udGet(ud, 22) == (void*) 3);
+  EXPECT(udGet(ud, 7) == (void*) 4);
+  EXPECT(udSize(ud) == 2);
+
+  udCleanup(&ud);
+
+  // Duplicates stay consistent
+  ud = udInit(16);
+  for (uintptr_t i = 0; i < 5; ++i){
+    udInsert(ud, 3, (void*) i);
+    udInsert(ud, 19, (void*) i);
+  }
+  UDITEM it = udNext(ud, udFind(ud, 3));
+  EXPECT(udValue(it) == (void*) 1);
+  EXPECT(udRemoveItem(ud, it) == 0);
+
+  it = udFind(ud, 3);
+  EXPECT(udLeft(ud, it) == 3);
+  uintptr_t expected[] = {0, 2, 3, 4};
+  for (int i = 0; i < 4; ++i){
+    EXPECT(udValue(it) == (void*) expected[i]);
+    EXPECT(udLeft(ud, it) == (uint32_t) (3 - i));
+    it = udNext(ud, it);
+  }
+  EXPECT(it == 0);
+  EXPECT(udRemove(ud, 19) == 5);
+  EXPECT(udSize(ud) == 4);
+
+  udCleanup(&ud);
+
+  // Churn keeps table size steady
+  uintptr_t* keys = (uintptr_t*)calloc(RTESTLEN, sizeof(uintptr_t));
+  ud = udInitEx(16, UD_INCREMENTAL);
+  for (uintptr_t i = 0; i < RTESTLEN; ++i){
+    keys[i] = i*2654435761u;
+    SEXPECT(udInsert(ud, keys[i], (void*) i) != 0);
+  }
+  uint32_t cap = udCap(ud);
+  for (uintptr_t round = 0; round < RTESTLEN*10; ++round){
+    uintptr_t i = rand() % RTESTLEN;
+    SEXPECT(udRemove(ud, keys[i]) == 1);
+    keys[i] = rand();
+    while (udFind(ud, keys[i]) != 0){
+      keys[i] = rand();
+    }
+    SEXPECT(udInsert(ud, keys[i], (void*) i) != 0);
+  }
+  EXPECT(udSize(ud) == RTESTLEN);
+  EXPECT(udCap(ud) == cap);
+  for (uintptr_t i = 0; i < RTESTLEN; ++i){
+    SEXPECT(udGet(ud, keys[i]) == (void*) i);
+  }
+
+  free(keys);
+  udCleanup(&ud);
+}
+
+void t013(){ // Robin Hood mode
+  const uint32_t modes[] = {UD_ROBINHOOD, UD_ROBINHOOD | UD_INCREMENTAL};
+
+  for (int mode = 0; mode < 2; ++mode){
+    UDICT ud = udInitEx(1024, modes[mode]);
+    EXPECT(ud != 0);
+
+    // Keys share low bits, so they fight for same buckets
+    for (uint32_t i = 0; i < 900; ++i){
+      SEXPECT(udInsert(ud, (i << 6) | (i & 7), (void*) (uintptr_t) (i + 1)) != 0);
+    }
+    // Equal keys in the middle of crowd
+    for (uintptr_t i = 0; i < 10; ++i){
+      SEXPECT(udInsert(ud, 5, (void*) i) != 0);
+    }
+    EXPECT(udSize(ud) == 910);
+
+    for (uint32_t i = 0; i < 900; ++i){
+      SEXPECT(udGet(ud, (i << 6) | (i & 7)) == (void*) (uintptr_t) (i + 1));
+      SEXPECT(udFind(ud, (i << 6) | 0x20) == 0);
+    }
+
+    UDITEM it = udFind(ud, 5);
+    for (uintptr_t i = 0; i < 10; ++i){
+      SEXPECT(udValue(it) == (void*) i);
+      SEXPECT(udLeft(ud, it) == 9 - i);
+      it = udNext(ud, it);
+    }
+    EXPECT(it == 0);
+
+    for (uint32_t i = 0; i < 900; i += 2){
+      SEXPECT(udRemove(ud, (i << 6) | (i & 7)) == 1);
+    }
+    EXPECT(udSize(ud) == 460);
+    for (uint32_t i = 0; i < 900; ++i){
+      SEXPECT(udGet(ud, (i << 6) | (i & 7)) == ((i % 2 == 0)?0:(void*) (uintptr_t) (i + 1)));
+    }
+    EXPECT(udReset(ud, 5, (void*) 77) != 0);
+    EXPECT(udGet(ud, 5) == (void*) 77);
+    EXPECT(udRemove(ud, 5) == 10);
+
+    udCleanup(&ud);
+  }
+
+  // Lookups at 90% load with clustered keys
+  for (int mode = 0; mode < 2; ++mode){
+    UDICT ud = udInitEx(1 << 16, (mode == 0)?UD_DEFAULT:UD_ROBINHOOD);
+    struct timespec start;
+    uintptr_t found = 0;
+
+    for (uint32_t i = 0; i < (1 << 16)*9/10; ++i){
+      udInsert(ud, (i << 5) | (i & 31), (void*) 1);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int round = 0; round < 4; ++round){
+      for (uint32_t i = 0; i < (1 << 16); ++i){
+        found += (uintptr_t) udGet(ud, (i << 5) | (i & 31));
+      }
+    }
+    printf("%s lookups: %f sec\n", (mode == 0)?"linear":"robin hood", GetTime(&start));
+    EXPECT(found == 4*((1 << 16)*9/10));
+    udCleanup(&ud);
+  }
+}
+
+void t014(){ // Separate key and value arrays
+  const uint32_t modes[] = {
+    UD_SOA,
+    UD_SOA | UD_ROBINHOOD,
+    UD_SOA | UD_INCREMENTAL
+  };
+
+  for (int mode = 0; mode < 3; ++mode){
+    UDICT ud = udInitEx(64, modes[mode]);
+    EXPECT(ud != 0);
+
+    for (uintptr_t i = 0; i < 50; ++i){
+      UDITEM it = udInsert(ud, (uint32_t) (i*64 + 1), (void*) (i + 1));
+      SEXPECT(it != 0);
+      SEXPECT(udItemKey(ud, it) == i*64 + 1);
+      SEXPECT(udValue(it) == (void*) (i + 1));
+    }
+    for (uintptr_t i = 0; i < 3; ++i){
+      SEXPECT(udInsert(ud, 1, (void*) (i + 100)) != 0);
+    }
+    EXPECT(udSize(ud) == 53);
+
+    for (uintptr_t i = 0; i < 50; ++i){
+      SEXPECT(udGet(ud, (uint32_t) (i*64 + 1)) == (void*) (i + 1));
+    }
+
+    UDITEM it = udFind(ud, 1);
+    EXPECT(udLeft(ud, it) == 3);
+    for (uintptr_t i = 100; i < 103; ++i){
+      it = udNext(ud, it);
+      EXPECT(udItemKey(ud, it) == 1);
+      EXPECT(udValue(it) == (void*) i);
+    }
+
+    udSetValue(udFind(ud, 65), (void*) 42);
+    EXPECT(udGet(ud, 65) == (void*) 42);
+    EXPECT(udRemove(ud, 65) == 1);
+    EXPECT(udGet(ud, 65) == 0);
+
+    uint32_t count = 0;
+    for (it = udIterFirst(ud); it != 0; it = udIterNext(ud, it)){
+      ++count;
+    }
+    EXPECT(count == 52);
+
+    UDITEM last = udIterLast(ud);
+    EXPECT(last != 0);
+    EXPECT(udFind(ud, udItemKey(ud, last)) != 0);
+
+    ud = udRehash(&ud, 256);
+    EXPECT(udSize(ud) == 52);
+    EXPECT(udGet(ud, 129) == (void*) 3);
+
+    udCleanup(&ud);
+  }
+}
+
+#define BTESTLEN (1 << 22)
+
+void t015(){ // Batched lookups
+  const uint32_t modes[] = {UD_DEFAULT, UD_SOA, UD_ROBINHOOD, UD_INCREMENTAL};
+  uint32_t keys[100] = {0};
+  UDITEM out[100];
+
+  EXPECT(udFindBatch(0, keys, 100, out) == 0); // No segfault
+
+  for (int mode = 0; mode < 4; ++mode){
+    UDICT ud = udInitEx((modes[mode] == UD_INCREMENTAL)?16:128, modes[mode]);
+    for (uintptr_t i = 0; i < 100; ++i){
+      keys[i] = (uint32_t) (i*2654435761u);
+      if (i % 3 != 0){
+        udInsert(ud, keys[i], (void*) i);
+      }
+    }
+    EXPECT(udFindBatch(ud, keys, 100, out) == 66);
+    for (uintptr_t i = 0; i < 100; ++i){
+      SEXPECT((i % 3 == 0)?(out[i] == 0):(udValue(out[i]) == (void*) i));
+    }
+    udCleanup(&ud);
+  }
+
+  // Long probe sequences resolved in different rounds
+  for (int mode = 0; mode < 3; ++mode){
+    UDICT ud = udInitEx(256, modes[mode]);
+    udSetHashFunc(ud, udHashIdentity);
+    for (uintptr_t i = 0; i < 200; ++i){
+      udInsert(ud, (uint32_t) ((i % 4 == 0)?(i*256):(i*256 + 7)), (void*) i); // Two long runs
+    }
+    for (uint32_t i = 0; i < 100; ++i){
+      keys[i] = (i % 2 == 0)?(i*128u + 7):(i*1024u + 3); // Odd ones are missing
+    }
+    size_t expected = 0;
+    for (uint32_t i = 0; i < 100; ++i){
+      expected += (udFind(ud, keys[i]) != 0);
+    }
+    EXPECT((expected > 0) && (udFindBatch(ud, keys, 100, out) == expected));
+    for (uint32_t i = 0; i < 100; ++i){
+      SEXPECT(out[i] == udFind(ud, keys[i]));
+    }
+    udCleanup(&ud);
+  }
+
+  // Table is much larger than cache
+  uint32_t* bkeys = (uint32_t*)calloc(BTESTLEN, sizeof(uint32_t));
+  UDITEM* bout = (UDITEM*)calloc(BTESTLEN, sizeof(UDITEM));
+  UDICT ud = udInit(BTESTLEN);
+  struct timespec start;
+  size_t found = 0;
+
+  for (uint32_t i = 0; i < BTESTLEN*3/4; ++i){
+    udInsert(ud, i*2654435761u, 0);
+  }
+  for (uint32_t i = 0; i < BTESTLEN; ++i){
+    bkeys[i] = ((uint32_t) rand() % BTESTLEN)*2654435761u;
+  }
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for (uint32_t i = 0; i < BTESTLEN; ++i){
+    bout[i] = udFind(ud, bkeys[i]);
+    found += (bout[i] != 0);
+  }
+  printf("udFind loop: %f sec\n", GetTime(&start));
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  EXPECT(udFindBatch(ud, bkeys, BTESTLEN, bout) == found);
+  printf("udFindBatch: %f sec\n", GetTime(&start));
+
+  udCleanup(&ud);
+  free(bkeys);
+  free(bout);
+}
+
+static uint32_t cleaned = 0;
+
+static void CountCleanup(UDITEM item){
+  (void) item;
+  ++cleaned;
+}
+
+void t016(){ // Iteration over sparse table
+  UDICT ud = udInit(1 << 20);
+  uintptr_t sum = 0;
+
+  EXPECT(udIterFirst(ud) == 0);
+  EXPECT(udIterLast(ud) == 0);
+
+  for (uintptr_t i = 1; i <= 1000; ++i){
+    udInsert(ud, (uint32_t) i, (void*) i);
+  }
+  for (uintptr_t i = 1; i <= 1000; i += 2){
+    udRemove(ud, (uint32_t) i);
+  }
+
+  UDITEM last = 0;
+  for (int round = 0; round < 100; ++round){
+    for (UDITEM it = udIterFirst(ud); it != 0; it = udIterNext(ud, it)){
+      sum += (uintptr_t) udValue(it);
+      last = it;
+    }
+  }
+  EXPECT(sum == 100*(1000/2)*(1000/2 + 1)); // Sum of even numbers up to 1000
+  EXPECT(last == udIterLast(ud));
+
+  cleaned = 0;
+  udCleanupDeep(&ud, CountCleanup);
+  EXPECT(cleaned == 500);
+  EXPECT(ud == 0);
+}
+
+typedef struct _udc_reader_job_ {
+  UDCONC uc;
+  uint32_t keys; /* Keys [0, keys) are always present */
+  uint32_t loops;
+  uint32_t misses;
+} udcReaderJob;
+
+static void* UdcReaderThread(void* arg){
+  udcReaderJob* job = (udcReaderJob*) arg;
+  UDCREADER rd = udcAttach(job->uc);
+  uint32_t seed = (uint32_t)(uintptr_t) arg;
+
+  for (uint32_t i = 0; i < job->loops; ++i){
+    void* value = 0;
+    seed = seed*1664525u + 1013904223u;
+    uint32_t key = (seed >> 8) % job->keys;
+    udcReadBegin(rd);
+    if ((udcFind(rd, key, &value) == 0) || (value != (void*)(uintptr_t)(key + 1))){
+      ++job->misses;
+    }
+    udcReadEnd(rd);
+  }
+  udcDetach(&rd);
+  return 0;
+}
+
+void t017(){ // Concurrent read-mostly table
+  EXPECT(udcInit(0) == 0);
+  EXPECT(udcSize(0) == 0);
+  EXPECT(udcReset(0, 1, 0) == -1);
+  EXPECT(udcAttach(0) == 0);
+  EXPECT(udcGet(0, 1) == 0);
+
+  UDCONC uc = udcInit(16);
+  UDCREADER rd = udcAttach(uc);
+  EXPECT(rd != 0);
+
+  for (uintptr_t i = 0; i < RTESTLEN; ++i){
+    SEXPECT(udcReset(uc, (uint32_t) i, (void*)(i + 1)) == 0);
+  }
+  EXPECT(udcSize(uc) == RTESTLEN);
+  EXPECT(udcReset(uc, 10, (void*) 100) == 0);
+  EXPECT(udcSize(uc) == RTESTLEN);
+  EXPECT(udcGet(rd, 10) == (void*) 100);
+  EXPECT(udcReset(uc, 10, (void*) 11) == 0);
+  EXPECT(udcGet(rd, RTESTLEN + 1) == 0);
+  for (uintptr_t i = 0; i < RTESTLEN; ++i){
+    SEXPECT(udcGet(rd, (uint32_t) i) == (void*)(i + 1));
+  }
+  udcDetach(&rd);
+  EXPECT(rd == 0);
+
+  // Readers must always see old keys, while writer grows table
+  udcReaderJob jobs[4];
+  pthread_t threads[4];
+  for (int i = 0; i < 4; ++i){
+    jobs[i] = (udcReaderJob){uc, RTESTLEN, 1 << 18, 0};
+    EXPECT(pthread_create(threads + i, 0, UdcReaderThread, jobs + i) == 0);
+  }
+  for (uintptr_t i = RTESTLEN; i < RTESTLEN*16; ++i){
+    SEXPECT(udcReset(uc, (uint32_t) i, (void*)(i + 1)) == 0);
+  }
+  for (int i = 0; i < 4; ++i){
+    pthread_join(threads[i], 0);
+    EXPECT(jobs[i].misses == 0);
+  }
+  EXPECT(udcSize(uc) == RTESTLEN*16);
+
+  // Read scaling
+  for (int count = 1; count <= 4; count *= 2){
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < count; ++i){
+      jobs[i] = (udcReaderJob){uc, RTESTLEN*16, 1 << 20, 0};
+      pthread_create(threads + i, 0, UdcReaderThread, jobs + i);
+    }
+    for (int i = 0; i < count; ++i){
+      pthread_join(threads[i], 0);
+      SEXPECT(jobs[i].misses == 0);
+    }
+    double elapsed = GetTime(&start);
+    printf("%d readers: %f Mlookups/sec\n", count, count*(double)(1 << 20)/elapsed*1.0e-6);
+  }
+
+  udcCleanup(&uc);
+  EXPECT(uc == 0);
+}
+
+typedef struct _uds_writer_job_ {
+  UDSHARD uds; /* Sharded table, or zero to use single locked UDICT */
+  UDICT ud;
+  pthread_mutex_t* lock;
+  uint32_t first;
+  uint32_t count;
+} udsWriterJob;
+
+static void* UdsWriterThread(void* arg){
+  udsWriterJob* job = (udsWriterJob*) arg;
+  for (uint32_t i = job->first; i < job->first + job->count; ++i){
+    if (job->uds != 0){
+      udsReset(job->uds, i*2654435761u, (void*)(uintptr_t) i);
+    } else {
+      pthread_mutex_lock(job->lock);
+      udReset(job->ud, i*2654435761u, (void*)(uintptr_t) i);
+      pthread_mutex_unlock(job->lock);
+    }
+  }
+  return 0;
+}
+
+void t018(){ // Sharded table
+  EXPECT(udsInit(0, 4) == 0);
+  EXPECT(udsInit(16, 0) == 0);
+  EXPECT(udsInit(16, 4096) == 0);
+  EXPECT(udsSize(0) == 0);
+  EXPECT(udsInsert(0, 1, 0) == -1);
+  EXPECT(udsFind(0, 1, 0) == 0);
+
+  UDSHARD uds = udsInit(16, 5);
+  EXPECT(udsShards(uds) == 8);
+
+  for (uintptr_t i = 0; i < RTESTLEN; ++i){
+    SEXPECT(udsInsert(uds, (uint32_t) i, (void*) i) == 0);
+  }
+  EXPECT(udsInsert(uds, 10, (void*) 100) == 0); // Duplicate
+  EXPECT(udsSize(uds) == RTESTLEN + 1);
+  EXPECT(udsRemove(uds, 10) == 2);
+  EXPECT(udsFind(uds, 10, 0) == 0);
+  EXPECT(udsReset(uds, 10, (void*) 10) == 0);
+  EXPECT(udsReset(uds, 10, (void*) 11) == 0);
+  EXPECT(udsSize(uds) == RTESTLEN);
+
+  void* value = 0;
+  EXPECT(udsFind(uds, 10, &value) == 1);
+  EXPECT(value == (void*) 11);
+  for (uintptr_t i = 11; i < RTESTLEN; ++i){
+    SEXPECT((udsFind(uds, (uint32_t) i, &value) == 1) && (value == (void*) i));
+  }
+  udsCleanup(&uds);
+  EXPECT(uds == 0);
+
+  // Writers to sharded table against single locked UDICT
+  const uint32_t perThread = 1 << 18;
+  udsWriterJob jobs[4];
+  pthread_t threads[4];
+  pthread_mutex_t lock;
+  pthread_mutex_init(&lock, 0);
+
+  for (int sharded = 0; sharded < 2; ++sharded){
+    UDICT ud = (sharded == 0)?udInitEx(16, UD_INCREMENTAL):0;
+    uds = (sharded != 0)?udsInit(16, 64):0;
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < 4; ++i){
+      jobs[i] = (udsWriterJob){uds, ud, &lock, i*perThread, perThread};
+      EXPECT(pthread_create(threads + i, 0, UdsWriterThread, jobs + i) == 0);
+    }
+    for (int i = 0; i < 4; ++i){
+      pthread_join(threads[i], 0);
+    }
+    printf("%s: %f Minserts/sec\n", (sharded != 0)?"udsReset":"locked udReset",
+      4*(double)perThread/GetTime(&start)*1.0e-6);
+    if (sharded != 0){
+      EXPECT(udsSize(uds) == 4*perThread);
+      for (uint32_t i = 0; i < 4*perThread; i += 97){
+        SEXPECT((udsFind(uds, i*2654435761u, &value) == 1) && (value == (void*)(uintptr_t) i));
+      }
+    } else {
+      EXPECT(udSize(ud) == 4*perThread);
+    }
+    udsCleanup(&uds);
+    udCleanup(&ud);
+  }
+  pthread_mutex_destroy(&lock);
+}
+
+void t019(){ // 64-bit keys
+  const uint32_t modes[] = {UD_DEFAULT, UD_SOA, UD_ROBINHOOD, UD_INCREMENTAL};
+
+  EXPECT(ud64Init(0) == 0);
+  EXPECT(ud64Size(0) == 0);
+  EXPECT(ud64HashIdentity(0x0000000100000002ull) == 3);
+
+  for (int mode = 0; mode < 4; ++mode){
+    UDICT64 ud = ud64InitEx((modes[mode] == UD_INCREMENTAL)?16:4*RTESTLEN, modes[mode]);
+    uintptr_t sum = 0;
+
+    // Keys differ only in high half, so 32-bit truncation would collide
+    for (uintptr_t i = 0; i < RTESTLEN; ++i){
+      SEXPECT(ud64Insert(ud, ((uint64_t) i << 32) | 7, (void*) i) != 0);
+    }
+    EXPECT(ud64Insert(ud, 7, (void*) 1000) != 0); // Duplicate of i == 0
+    EXPECT(ud64Size(ud) == RTESTLEN + 1);
+
+    for (uintptr_t i = 1; i < RTESTLEN; ++i){
+      UDITEM64 item = ud64Find(ud, ((uint64_t) i << 32) | 7);
+      SEXPECT((item != 0) && (ud64Value(item) == (void*) i) && (ud64Left(ud, item) == 0));
+      SEXPECT(ud64ItemKey(ud, item) == (((uint64_t) i << 32) | 7));
+    }
+
+    UDITEM64 item = ud64Find(ud, 7);
+    EXPECT(ud64Left(ud, item) == 1);
+    EXPECT(ud64Value(ud64Next(ud, item)) == (void*) 1000);
+    EXPECT(ud64Find(ud, 8) == 0);
+    EXPECT(ud64Remove(ud, 7) == 2);
+
+    for (item = ud64IterFirst(ud); item != 0; item = ud64IterNext(ud, item)){
+      sum += (uintptr_t) ud64Value(item);
+    }
+    EXPECT(sum == (uintptr_t) RTESTLEN*(RTESTLEN - 1)/2);
+    ud64Cleanup(&ud);
+    EXPECT(ud == 0);
+  }
+}
+
+typedef struct _inline_value_ {
+  uint64_t count;
+  uint32_t first;
+  uint32_t last;
+  double sum;
+} inlineValue;
+
+static void FreeValue(UDITEM item){
+  free(udValue(item));
+}
+
+void t020(){ // Inline values
+  const uint32_t modes[] = {UD_DEFAULT, UD_SOA, UD_ROBINHOOD, UD_INCREMENTAL};
+
+  EXPECT(udInitInline(16, UD_DEFAULT, 0) == 0);
+  EXPECT(udInitInline(16, UD_DEFAULT, UD_INLINE_MAX + 1) == 0);
+
+  for (int mode = 0; mode < 4; ++mode){
+    UDICT ud = udInitInline((modes[mode] == UD_INCREMENTAL)?16:4*RTESTLEN, modes[mode], sizeof(inlineValue));
+    uint64_t total = 0;
+
+    // Every key is seen several times, like in counter table
+    for (uint32_t i = 0; i < 3*RTESTLEN; ++i){
+      uint32_t key = (i % RTESTLEN)*2654435761u;
+      inlineValue* val = (inlineValue*) udGet(ud, key);
+      if (val == 0){
+        UDITEM item = udInsert(ud, key, 0);
+        SEXPECT(item != 0);
+        val = (inlineValue*) udValuePtr(item);
+        SEXPECT(val->count == 0);
+        val->first = i;
+      }
+      val->count += 1;
+      val->last = i;
+      val->sum += 0.5;
+    }
+    EXPECT(udSize(ud) == RTESTLEN);
+
+    // Values move with items on growth and Robin Hood displacement
+    for (uint32_t i = 0; i < RTESTLEN; ++i){
+      inlineValue* val = (inlineValue*) udGet(ud, i*2654435761u);
+      SEXPECT((val != 0) && (val->count == 3) && (val->first == i) && (val->last == i + 2*RTESTLEN) && (val->sum == 1.5));
+    }
+
+    inlineValue reset = {100, 1, 2, 3.0};
+    EXPECT(udReset(ud, 0, &reset) != 0);
+    EXPECT(((inlineValue*) udGet(ud, 0))->count == 100);
+
+    ud = udRehash(&ud, 8*RTESTLEN);
+    EXPECT(ud != 0);
+    for (UDITEM it = udIterFirst(ud); it != 0; it = udIterNext(ud, it)){
+      total += ((inlineValue*) udValuePtr(it))->count;
+    }
+    EXPECT(total == 3*(RTESTLEN - 1) + 100);
+    udCleanup(&ud);
+  }
+
+  // Counter table against boxed values
+  UDICT boxed = udInitEx(16, UD_INCREMENTAL);
+  UDICT inlined = udInitInline(16, UD_INCREMENTAL, sizeof(uint64_t));
+  struct timespec start;
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for (uint32_t i = 0; i < BTESTLEN/4; ++i){
+    uint32_t key = (uint32_t) i % (BTESTLEN/16);
+    uint64_t* cnt = (uint64_t*) udGet(boxed, key);
+    if (cnt == 0){
+      cnt = (uint64_t*) calloc(1, sizeof(uint64_t));
+      udInsert(boxed, key, cnt);
+    }
+    ++*cnt;
+  }
+  printf("boxed counters: %f sec\n", GetTime(&start));
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for (uint32_t i = 0; i < BTESTLEN/4; ++i){
+    uint32_t key = (uint32_t) i % (BTESTLEN/16);
+    uint64_t* cnt = (uint64_t*) udGet(inlined, key);
+    if (cnt == 0){
+      cnt = (uint64_t*) udValuePtr(udInsert(inlined, key, 0));
+    }
+    ++*cnt;
+  }
+  printf("inline counters: %f sec\n", GetTime(&start));
+
+  EXPECT(*(uint64_t*) udGet(inlined, 7) == 4);
+  EXPECT(*(uint64_t*) udGet(boxed, 7) == 4);
+  udCleanupDeep(&boxed, FreeValue);
+  udCleanup(&inlined);
+}
+
+static uint32_t MyHash(uint32_t key){
+  return key*7;
+}
+
+void t021(){ // Saved and mapped tables
+  const uint32_t modes[] = {UD_DEFAULT, UD_SOA | UD_INLINE, UD_ROBINHOOD | UD_INLINE, UD_INCREMENTAL};
+  const char* path = "udict-test.map";
+
+  EXPECT(udSave(0, path) == -1);
+  EXPECT(udMapFile(0) == 0);
+  EXPECT(udMapFile("no-such-file.map") == 0);
+
+  UDICT ud = udInit(16);
+  udSetHashFunc(ud, MyHash);
+  EXPECT(udSave(ud, path) == -1); // Custom hash can not be saved
+  udCleanup(&ud);
+
+  for (int mode = 0; mode < 4; ++mode){
+    if ((modes[mode] & UD_INLINE) != 0){
+      ud = udInitInline(4*RTESTLEN, modes[mode], sizeof(uint64_t));
+    } else {
+      ud = udInitEx((modes[mode] == UD_INCREMENTAL)?16:4*RTESTLEN, modes[mode]);
+    }
+    for (uint64_t i = 0; i < RTESTLEN; ++i){
+      uint64_t value = i*3;
+      SEXPECT(udInsert(ud, (uint32_t) i*2654435761u, ((modes[mode] & UD_INLINE) != 0)?(void*)&value:(void*)(uintptr_t)value) != 0);
+    }
+    EXPECT(udInsert(ud, 0, 0) != 0); // Duplicate of key 0
+    EXPECT(udSave(ud, path) == 0);
+
+    UDICT map = udMapFile(path);
+    EXPECT(map != 0);
+    EXPECT(udSize(map) == RTESTLEN + 1);
+    EXPECT(udCap(map) == udCap(ud));
+    for (uint64_t i = 0; i < RTESTLEN; ++i){
+      UDITEM item = udFind(map, (uint32_t) i*2654435761u);
+      SEXPECT(item != 0);
+      if ((modes[mode] & UD_INLINE) != 0){
+        SEXPECT(*(uint64_t*)udValuePtr(item) == i*3);
+      } else {
+        SEXPECT(udValue(item) == (void*)(uintptr_t)(i*3));
+      }
+    }
+    EXPECT(udLeft(map, udFind(map, 0)) == 1);
+    EXPECT(udFind(map, 1) == 0);
+
+    EXPECT(udInsert(map, 1, 0) == 0);
+    EXPECT(udReset(map, 0, 0) == 0);
+    EXPECT(udRemove(map, 0) == 0);
+    EXPECT(udRemoveItem(map, udFind(map, 0)) == -1);
+
+    uint32_t count = 0;
+    for (UDITEM it = udIterFirst(map); it != 0; it = udIterNext(map, it)){
+      ++count;
+    }
+    EXPECT(count == RTESTLEN + 1);
+
+    // Writable copy
+    map = udRehash(&map, udCap(ud)*2);
+    EXPECT(map != 0);
+    EXPECT(udInsert(map, 1, 0) != 0);
+    EXPECT(udSize(map) == RTESTLEN + 2);
+    udCleanup(&map);
+    udCleanup(&ud);
+  }
+
+  // Mapping against rebuilding
+  struct timespec start;
+  ud = udInitInline(BTESTLEN/4, UD_DEFAULT, sizeof(uint64_t));
+  for (uint64_t i = 0; i < BTESTLEN*3/16; ++i){
+    udInsert(ud, (uint32_t) i, &i);
+  }
+  EXPECT(udSave(ud, path) == 0);
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  UDICT copy = udInitInline(BTESTLEN/4, UD_DEFAULT, sizeof(uint64_t));
+  for (UDITEM it = udIterFirst(ud); it != 0; it = udIterNext(ud, it)){
+    udInsert(copy, udItemKey(ud, it), udValuePtr(it));
+  }
+  printf("rebuild: %f sec\n", GetTime(&start));
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  UDICT map = udMapFile(path);
+  printf("map: %f sec\n", GetTime(&start));
+
+  EXPECT(udSize(map) == udSize(copy));
+  EXPECT(*(uint64_t*)udGet(map, 12345) == 12345);
+
+  // Broken files
+  FILE* file = fopen(path, "r+b");
+  fseek(file, 0, SEEK_SET);
+  fputc('X', file);
+  fclose(file);
+  EXPECT(udMapFile(path) == 0);
+
+  udCleanup(&map);
+  udCleanup(&copy);
+  udCleanup(&ud);
+  remove(path);
+}
+
+void t022(){ // Bulk build
+  const size_t count = 4*RTESTLEN;
+  uint32_t* keys = (uint32_t*) calloc(count, sizeof(uint32_t));
+  void** values = (void**) calloc(count, sizeof(void*));
+
+  UDICT ud = udBuildBulk(0, 0, 0, 4);
+  EXPECT(ud != 0);
+  EXPECT(udSize(ud) == 0);
+  udCleanup(&ud);
+  EXPECT(udBuildBulk(0, 0, 10, 4) == 0);
+
+  ud = udBuildBulk(keys, 0, 1, 1);
+  EXPECT((udSize(ud) == 1) && (udFind(ud, 0) != 0) && (udGet(ud, 0) == 0));
+  udCleanup(&ud);
+
+  // Many duplicates
+  for (size_t i = 0; i < count; ++i){
+    keys[i] = (uint32_t) rand() % (count/3);
+    values[i] = (void*)(uintptr_t) i;
+  }
+
+  UDICT ref = udInitEx(16, UD_INCREMENTAL);
+  for (size_t i = 0; i < count; ++i){
+    udInsert(ref, keys[i], values[i]);
+  }
+
+  for (uint32_t threads = 1; threads <= 8; threads *= 2){
+    ud = udBuildBulk(keys, values, count, threads);
+    EXPECT(ud != 0);
+    EXPECT(udSize(ud) == count);
+
+    // Same values in the same udNext order, as in table built with udInsert
+    for (uint32_t key = 0; key < count/3; ++key){
+      UDITEM a = udFind(ud, key);
+      UDITEM b = udFind(ref, key);
+      SEXPECT((a == 0) == (b == 0));
+      if (a != 0){
+        SEXPECT(udLeft(ud, a) == udLeft(ref, b));
+      }
+      while ((a != 0) && (b != 0)){
+        SEXPECT(udValue(a) == udValue(b));
+        SEXPECT(udLeft(ud, a) == udLeft(ref, b));
+        a = udNext(ud, a);
+        b = udNext(ref, b);
+      }
+      SEXPECT((a == 0) && (b == 0));
+    }
+
+    // Still usable for insertion and removal
+    uint32_t zeros = (udFind(ud, 0) != 0)?(udLeft(ud, udFind(ud, 0)) + 1):0;
+    EXPECT(udInsert(ud, 0, (void*) 1) != 0);
+    EXPECT(udRemove(ud, 0) == zeros + 1);
+    udCleanup(&ud);
+  }
+  udCleanup(&ref);
+  free(keys);
+  free(values);
+
+  // Bulk build against udInsert loop
+  keys = (uint32_t*) calloc(BTESTLEN/4, sizeof(uint32_t));
+  for (size_t i = 0; i < BTESTLEN/4; ++i){
+    keys[i] = (uint32_t) i*2654435761u;
+  }
+
+  struct timespec start;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  ref = udInitEx(16, UD_INCREMENTAL);
+  for (size_t i = 0; i < BTESTLEN/4; ++i){
+    udInsert(ref, keys[i], 0);
+  }
+  printf("udInsert loop: %f sec\n", GetTime(&start));
+
+  for (uint32_t threads = 1; threads <= 4; threads *= 2){
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    ud = udBuildBulk(keys, 0, BTESTLEN/4, threads);
+    printf("udBuildBulk, %u threads: %f sec\n", threads, GetTime(&start));
+    EXPECT(udSize(ud) == BTESTLEN/4);
+    EXPECT(udFind(ud, keys[12345]) != 0);
+    udCleanup(&ud);
+  }
+  udCleanup(&ref);
+  free(keys);
+}
+
+void t023(){ // Table statistics
+  udStats_t stats;
+  UDICT ud = udInitEx(16, UD_DEFAULT);
+
+  EXPECT(udStats(0, &stats) == -1);
+  EXPECT(udStats(ud, 0) == -1);
+  EXPECT(udStats(ud, &stats) == 0);
+  EXPECT((stats.size == 0) && (stats.cap == 16) && (stats.clusters == 0) && (stats.maxDupChain == 0));
+
+  udSetHashFunc(ud, udHashIdentity);
+  udInsert(ud, 1, 0); // bucket 1
+  udInsert(ud, 1, 0); // bucket 2
+  udInsert(ud, 1, 0); // bucket 3
+  udInsert(ud, 2, 0); // bucket 4, two buckets away from home
+  udInsert(ud, 15, 0); // bucket 15
+  udInsert(ud, 31, 0); // bucket 0, wrapped
+
+  EXPECT(udStats(ud, &stats) == 0);
+  EXPECT(stats.size == 6);
+  EXPECT((stats.probe[0] == 2) && (stats.probe[1] == 2) && (stats.probe[2] == 2));
+  EXPECT((stats.maxProbe == 2) && (stats.meanProbe == 1.0));
+  EXPECT((stats.clusters == 1) && (stats.maxCluster == 6) && (stats.cluster[2] == 1));
+  EXPECT((stats.dupKeys == 1) && (stats.dupItems == 3) && (stats.maxDupChain == 3));
+  EXPECT(stats.wrapped == 1);
+
+  for (uint32_t i = 100; udSize(ud) < 16; ++i){
+    udInsert(ud, i, 0);
+  }
+  EXPECT(udStats(ud, &stats) == 0);
+  EXPECT((stats.clusters == 1) && (stats.maxCluster == 16) && (stats.cluster[4] == 1));
+  udCleanup(&ud);
+
+  // Hashing policies on structured keys
+  for (int policy = 0; policy < 2; ++policy){
+    ud = udInitEx(16, UD_INCREMENTAL);
+    udSetHashFunc(ud, (policy == 0)?udHashIdentity:udHashMix);
+    for (uint32_t i = 0; i < RTESTLEN; ++i){
+      udInsert(ud, i << 5, 0);
+    }
+    for (uint32_t i = 0; i < RTESTLEN; ++i){
+      udFind(ud, i << 5);
+    }
+    EXPECT(udStats(ud, &stats) == 0);
+    EXPECT(stats.size == RTESTLEN);
+    printf("%s: mean probe %f, max probe %u, mean cluster %f, max cluster %u\n",
+      (policy == 0)?"udHashIdentity":"udHashMix",
+      stats.meanProbe, stats.maxProbe, stats.meanCluster, stats.maxCluster);
+    if (stats.counters != 0){
+      EXPECT((stats.lookups >= RTESTLEN) && (stats.inserts >= RTESTLEN) && (stats.rehashes > 0));
+      printf("lookups %" PRIu64 ", probes %" PRIu64 ", inserts %" PRIu64 ", rehashes %" PRIu64 ", wraps %" PRIu64 "\n",
+        stats.lookups, stats.probes, stats.inserts, stats.rehashes, stats.wraps);
+    }
+    udCleanup(&ud);
+  }
+}
+
+typedef struct {
+  RBSPSC rb;
+  RBUF locked;
+  pthread_mutex_t* lock;
+  uintptr_t count;
+} rbProducerJob;
+
+void* RbspscProducerThread(void* arg){
+  rbProducerJob* job = (rbProducerJob*) arg;
+  for (uintptr_t i = 1; i <= job->count; ++i){
+    while (rbspscPush(job->rb, (void*) i) != 0){
+      sched_yield();
+    }
+  }
+  return 0;
+}
+
+void* RbufProducerThread(void* arg){
+  rbProducerJob* job = (rbProducerJob*) arg;
+  for (uintptr_t i = 1; i <= job->count; ++i){
+    for (;;){
+      pthread_mutex_lock(job->lock);
+      if (rbufSize(job->locked) < rbufCap(job->locked)){
+        rbufPushBack(job->locked, (void*) i);
+        pthread_mutex_unlock(job->lock);
+        break;
+      }
+      pthread_mutex_unlock(job->lock);
+      sched_yield();
+    }
+  }
+  return 0;
+}
+
+void t024(){ // Single-producer/single-consumer ring
+  void* value = 0;
+
+  EXPECT(rbspscInit(0) == 0);
+  EXPECT(rbspscCap(0) == 0);
+  EXPECT(rbspscSize(0) == 0);
+  EXPECT(rbspscPush(0, 0) == -1);
+  EXPECT(rbspscPop(0, &value) == -1);
+  rbspscCleanup(0); // No segfault
+
+  RBSPSC rb = rbspscInit(5);
+  EXPECT(rbspscCap(rb) == 8);
+  EXPECT(rbspscPop(rb, &value) == -1);
+  for (uintptr_t i = 0; i < 8; ++i){
+    EXPECT(rbspscPush(rb, (void*) i) == 0);
+  }
+  EXPECT(rbspscPush(rb, (void*) 8) == -1); // Full ring never overwrites
+  EXPECT(rbspscSize(rb) == 8);
+  for (uintptr_t i = 0; i < 8; ++i){
+    EXPECT((rbspscPop(rb, &value) == 0) && (value == (void*) i));
+  }
+  EXPECT(rbspscPop(rb, 0) == -1);
+  EXPECT(rbspscSize(rb) == 0);
+
+  // Indexes wrap many times
+  for (uintptr_t i = 0; i < RTESTLEN; ++i){
+    SEXPECT(rbspscPush(rb, (void*) i) == 0);
+    SEXPECT(rbspscPush(rb, (void*) (i + 1)) == 0);
+    SEXPECT((rbspscPop(rb, &value) == 0) && (value == (void*) i));
+    SEXPECT((rbspscPop(rb, &value) == 0) && (value == (void*) (i + 1)));
+  }
+  rbspscCleanup(&rb);
+  EXPECT(rb == 0);
+
+  // Hand-off between threads keeps order
+  const uintptr_t count = 1 << 20;
+  pthread_t thread;
+  rbProducerJob job = {rbspscInit(1024), 0, 0, count};
+  struct timespec start;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  EXPECT(pthread_create(&thread, 0, RbspscProducerThread, &job) == 0);
+  for (uintptr_t i = 1; i <= count; ++i){
+    while (rbspscPop(job.rb, &value) != 0){
+      sched_yield();
+    }
+    SEXPECT(value == (void*) i);
+  }
+  pthread_join(thread, 0);
+  printf("RBSPSC: %f Mmsg/sec\n", count/GetTime(&start)*1.0e-6);
+  EXPECT(rbspscSize(job.rb) == 0);
+  rbspscCleanup(&job.rb);
+
+  // Same hand-off with RBUF guarded by mutex
+  pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+  job = (rbProducerJob){0, rbufInit(1024), &lock, count};
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  EXPECT(pthread_create(&thread, 0, RbufProducerThread, &job) == 0);
+  for (uintptr_t i = 1; i <= count; ++i){
+    for (;;){
+      pthread_mutex_lock(&lock);
+      if (rbufSize(job.locked) != 0){
+        value = rbufPopFront(job.locked);
+        pthread_mutex_unlock(&lock);
+        break;
+      }
+      pthread_mutex_unlock(&lock);
+      sched_yield();
+    }
+    SEXPECT(value == (void*) i);
+  }
+  pthread_join(thread, 0);
+  printf("RBUF with mutex: %f Mmsg/sec\n", count/GetTime(&start)*1.0e-6);
+  rbufCleanup(&job.locked);
+}
+
+#define MPMC_MAX_THREADS (4)
+
+typedef struct {
+  RBMPMC rb;
+  uintptr_t id; // Producer index
+  uintptr_t count; // Items to push or pop
+  uintptr_t sum; // Sum of popped items
+  uintptr_t disorder; // Items of one producer popped out of order
+} rbMpmcJob;
+
+void* RbmpmcProducerThread(void* arg){
+  rbMpmcJob* job = (rbMpmcJob*) arg;
+  for (uintptr_t i = 1; i <= job->count; ++i){
+    rbmpmcPush(job->rb, (void*) ((job->id << 32) | i));
+  }
+  return 0;
+}
+
+void* RbmpmcConsumerThread(void* arg){
+  rbMpmcJob* job = (rbMpmcJob*) arg;
+  uintptr_t last[MPMC_MAX_THREADS] = {0};
+  void* value = 0;
+  for (uintptr_t i = 0; i < job->count; ++i){
+    rbmpmcPop(job->rb, &value);
+    uintptr_t producer = ((uintptr_t) value) >> 32;
+    uintptr_t seq = ((uintptr_t) value) & 0xFFFFFFFF;
+    job->disorder += (seq <= last[producer]);
+    last[producer] = seq;
+    job->sum += seq;
+  }
+  return 0;
+}
+
+void t025(){ // Multi-producer/multi-consumer queue
+  void* value = 0;
+
+  EXPECT(rbmpmcInit(0) == 0);
+  EXPECT(rbmpmcCap(0) == 0);
+  EXPECT(rbmpmcSize(0) == 0);
+  EXPECT(rbmpmcTryPush(0, 0) == -1);
+  EXPECT(rbmpmcTryPop(0, &value) == -1);
+  EXPECT(rbmpmcPush(0, 0) == -1);
+  EXPECT(rbmpmcPop(0, &value) == -1);
+  rbmpmcCleanup(0); // No segfault
+
+  RBMPMC rb = rbmpmcInit(1);
+  EXPECT(rbmpmcCap(rb) == 2); // Sequence numbers need two slots at least
+  rbmpmcCleanup(&rb);
+  EXPECT(rb == 0);
+
+  rb = rbmpmcInit(6);
+  EXPECT(rbmpmcCap(rb) == 8);
+  EXPECT(rbmpmcTryPop(rb, &value) == -1);
+  for (uintptr_t i = 0; i < 8; ++i){
+    EXPECT(rbmpmcTryPush(rb, (void*) i) == 0);
+  }
+  EXPECT(rbmpmcTryPush(rb, (void*) 8) == -1);
+  EXPECT(rbmpmcSize(rb) == 8);
+  for (uintptr_t i = 0; i < 8; ++i){
+    EXPECT((rbmpmcTryPop(rb, &value) == 0) && (value == (void*) i));
+  }
+  EXPECT(rbmpmcTryPop(rb, 0) == -1);
+  for (uintptr_t i = 0; i < RTESTLEN; ++i){
+    SEXPECT(rbmpmcPush(rb, (void*) i) == 0);
+    SEXPECT((rbmpmcPop(rb, &value) == 0) && (value == (void*) i));
+  }
+  EXPECT(rbmpmcSize(rb) == 0);
+  rbmpmcCleanup(&rb);
+
+  // Contention: every item is popped once, items of one producer keep order
+  const uintptr_t total = 1 << 18;
+  for (uintptr_t producers = 1; producers <= MPMC_MAX_THREADS; producers *= 2){
+    for (uintptr_t consumers = 1; consumers <= MPMC_MAX_THREADS; consumers *= 2){
+      rbMpmcJob pjobs[MPMC_MAX_THREADS];
+      rbMpmcJob cjobs[MPMC_MAX_THREADS];
+      pthread_t pthreads[MPMC_MAX_THREADS];
+      pthread_t cthreads[MPMC_MAX_THREADS];
+      uintptr_t sum = 0;
+      uintptr_t disorder = 0;
+      struct timespec start;
+
+      rb = rbmpmcInit(1024);
+      clock_gettime(CLOCK_MONOTONIC, &start);
+      for (uintptr_t i = 0; i < consumers; ++i){
+        cjobs[i] = (rbMpmcJob){rb, i, total/consumers, 0, 0};
+        SEXPECT(pthread_create(cthreads + i, 0, RbmpmcConsumerThread, cjobs + i) == 0);
+      }
+      for (uintptr_t i = 0; i < producers; ++i){
+        pjobs[i] = (rbMpmcJob){rb, i, total/producers, 0, 0};
+        SEXPECT(pthread_create(pthreads + i, 0, RbmpmcProducerThread, pjobs + i) == 0);
+      }
+      for (uintptr_t i = 0; i < producers; ++i){
+        pthread_join(pthreads[i], 0);
+      }
+      for (uintptr_t i = 0; i < consumers; ++i){
+        pthread_join(cthreads[i], 0);
+        sum += cjobs[i].sum;
+        disorder += cjobs[i].disorder;
+      }
+      double elapsed = GetTime(&start);
+      EXPECT(sum == producers*((total/producers)*(total/producers + 1)/2));
+      EXPECT(disorder == 0);
+      EXPECT(rbmpmcSize(rb) == 0);
+      printf("%"PRIuPTR" producers, %"PRIuPTR" consumers: %f Mmsg/sec\n",
+        producers, consumers, total/elapsed*1.0e-6);
+      rbmpmcCleanup(&rb);
+    }
+  }
+}
+
+void t026(){ // Power of two ring buffer and random access
+  EXPECT(rbufInitEx(0, RBUF_POW2) == 0);
+  EXPECT(rbufAt(0, 0) == 0); // No segfault
+
+  RBUF rb = rbufInitEx(5, RBUF_POW2);
+  EXPECT(rbufCap(rb) == 8);
+  EXPECT(rbufAt(rb, 0) == 0);
+
+  for (uintptr_t i = 0; i < 20; ++i){
+    rbufPushBack(rb, (void*) i);
+  }
+  EXPECT(rbufSize(rb) == 8);
+  for (size_t i = 0; i < 8; ++i){
+    EXPECT(rbufValue(rbufAt(rb, i)) == (void*) (12 + i));
+  }
+  EXPECT(rbufAt(rb, 8) == 0);
+  EXPECT(rbufAt(rb, 0) == rbufFront(rb));
+  EXPECT(rbufAt(rb, 7) == rbufBack(rb));
+
+  uintptr_t expect = 12;
+  for (RBITEM it = rbufFront(rb); it != 0; it = rbufNext(rb, it)){
+    EXPECT(rbufValue(it) == (void*) expect);
+    ++expect;
+  }
+  EXPECT(expect == 20);
+  for (RBITEM it = rbufBack(rb); it != 0; it = rbufPrev(rb, it)){
+    --expect;
+    EXPECT(rbufValue(it) == (void*) expect);
+  }
+  EXPECT(expect == 12);
+
+  EXPECT(rbufPopFront(rb) == (void*) 12);
+  EXPECT(rbufValue(rbufAt(rb, 0)) == (void*) 13);
+  EXPECT(rbufAt(rb, 7) == 0);
+  rbufCleanup(&rb);
+
+  // Capacity, which is power of two already, uses mask in default mode too
+  rb = rbufInit(4);
+  EXPECT(rbufCap(rb) == 4);
+  rbufCleanup(&rb);
+
+  // Window scan over large buffer
+  for (int mode = 0; mode < 2; ++mode){
+    const size_t cap = 1000000;
+    RBUF big = rbufInitEx(cap, (mode == 0)?RBUF_DEFAULT:RBUF_POW2);
+    for (uintptr_t i = 0; i < rbufCap(big) + cap/2; ++i){
+      rbufPushBack(big, (void*) i);
+    }
+
+    struct timespec start;
+    uintptr_t sum = 0;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (RBITEM it = rbufFront(big); it != 0; it = rbufNext(big, it)){
+      sum += (uintptr_t) rbufValue(it);
+    }
+    double walk = GetTime(&start);
+
+    uintptr_t sumAt = 0;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (size_t i = 0; i < rbufSize(big); ++i){
+      sumAt += (uintptr_t) rbufValue(rbufAt(big, i));
+    }
+    double at = GetTime(&start);
+
+    EXPECT(sum == sumAt);
+    printf("%s capacity %zu: rbufNext %f sec, rbufAt %f sec\n",
+      (mode == 0)?"default":"power of two", rbufCap(big), walk, at);
+    rbufCleanup(&big);
+  }
+}
+
+size_t rbufCleaned = 0;
+
+void RbufCountCleanup(void* value){
+  rbufCleaned += (value != 0);
+}
+
+void t027(){ // Batch push/pop and spans
+  void* in[16];
+  void* out[16];
+  rbufSpan spans[2];
+
+  for (uintptr_t i = 0; i < 16; ++i){
+    in[i] = (void*) (i + 1);
+  }
+
+  EXPECT(rbufPushBackN(0, in, 4) == 0);
+  EXPECT(rbufPopFrontN(0, out, 4) == 0);
+  EXPECT(rbufSpans(0, 0, 4, spans) == 0);
+
+  RBUF rb = rbufInit(6);
+  EXPECT(rbufPushBackN(rb, in, 0) == 0);
+  EXPECT(rbufSpans(rb, 0, 4, spans) == 0);
+  EXPECT(rbufPopFrontN(rb, out, 4) == 0);
+
+  EXPECT(rbufPushBackN(rb, in, 4) == 4);
+  EXPECT(rbufSize(rb) == 4);
+  EXPECT(rbufSpans(rb, 0, 10, spans) == 1);
+  EXPECT((spans[0].count == 4) && (spans[0].data[0] == in[0]) && (spans[0].data[3] == in[3]));
+  EXPECT(rbufPopFrontN(rb, out, 3) == 3);
+  EXPECT((out[0] == in[0]) && (out[2] == in[2]));
+
+  // Range wraps storage end
+  EXPECT(rbufPushBackN(rb, in + 4, 5) == 5);
+  EXPECT(rbufSize(rb) == 6);
+  EXPECT(rbufSpans(rb, 0, 6, spans) == 2);
+  EXPECT((spans[0].count == 3) && (spans[1].count == 3));
+  EXPECT((spans[0].data[0] == in[3]) && (spans[1].data[2] == in[8]));
+  EXPECT(rbufSpans(rb, 4, 6, spans) == 1);
+  EXPECT((spans[0].count == 2) && (spans[0].data[0] == in[7]));
+  EXPECT(rbufSpans(rb, 6, 1, spans) == 0);
+
+  // Overflow keeps newest elements, as rbufPushBack does
+  EXPECT(rbufPushBackN(rb, in, 3) == 3);
+  EXPECT(rbufSize(rb) == 6);
+  EXPECT(rbufValue(rbufFront(rb)) == in[6]);
+  EXPECT(rbufPushBackN(rb, in, 16) == 16);
+  EXPECT(rbufSize(rb) == 6);
+  EXPECT(rbufPopFrontN(rb, out, 16) == 6);
+  for (int i = 0; i < 6; ++i){
+    EXPECT(out[i] == in[10 + i]);
+  }
+  EXPECT(rbufSize(rb) == 0);
+
+  // Cleanup function sees every overwritten element
+  rbufSetCleanupFunc(rb, RbufCountCleanup);
+  rbufPushBackN(rb, in, 16);
+  EXPECT(rbufCleaned >= 10); // Reused slots are cleaned too
+  EXPECT(rbufValue(rbufFront(rb)) == in[10]);
+  EXPECT(rbufPopFrontN(rb, 0, 2) == 2);
+  EXPECT(rbufValue(rbufFront(rb)) == in[12]);
+  rbufCleanup(&rb);
+
+  // Batched transfer against per-item calls
+  const size_t batch = 64;
+  const size_t total = 1 << 20;
+  void* buffer[64];
+  for (int mode = 0; mode < 2; ++mode){
+    struct timespec start;
+    uintptr_t sum = 0;
+    rb = rbufInitEx(1024, RBUF_POW2);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (uintptr_t i = 0; i < total; i += batch){
+      for (size_t j = 0; j < batch; ++j){
+        buffer[j] = (void*) (i + j);
+      }
+      if (mode == 0){
+        for (size_t j = 0; j < batch; ++j){
+          rbufPushBack(rb, buffer[j]);
+        }
+        for (size_t j = 0; j < batch; ++j){
+          buffer[j] = rbufPopFront(rb);
+        }
+      }else{
+        rbufPushBackN(rb, buffer, batch);
+        rbufPopFrontN(rb, buffer, batch);
+      }
+      for (size_t j = 0; j < batch; ++j){
+        sum += (uintptr_t) buffer[j];
+      }
+    }
+    EXPECT(sum == (uintptr_t) total*(total - 1)/2);
+    printf("%s: %f Mitems/sec\n", (mode == 0)?"per item":"batched", total/GetTime(&start)*1.0e-6);
+    rbufCleanup(&rb);
+  }
+}
+
+void t028(){ // Byte ring buffer
+  size_t n = 0;
+  uint8_t bytes[256];
+  uint8_t out[256];
+
+  for (int i = 0; i < 256; ++i){
+    bytes[i] = (uint8_t) i;
+  }
+
+  EXPECT(rbbInit(0) == 0);
+  EXPECT(rbbCap(0) == 0);
+  EXPECT(rbbSize(0) == 0);
+  EXPECT(rbbReserve(0, &n) == 0);
+  EXPECT(rbbCommit(0, 0) == -1);
+  EXPECT(rbbPeek(0, &n) == 0);
+  EXPECT(rbbConsume(0, 0) == -1);
+  EXPECT(rbbWrite(0, bytes, 1) == 0);
+  EXPECT(rbbRead(0, out, 1) == 0);
+  EXPECT(rbbRecordReserve(0, 1) == 0);
+  EXPECT(rbbRecordCommit(0, 0) == -1);
+  EXPECT(rbbRecordPeek(0, &n) == 0);
+  EXPECT(rbbRecordConsume(0) == -1);
+  EXPECT(rbbRecordPush(0, bytes, 1) == -1);
+  rbbCleanup(0); // No segfault
+
+  // Byte stream
+  RBBYTES rb = rbbInit(100);
+  EXPECT(rbbCap(rb) == 128);
+  EXPECT(rbbPeek(rb, &n) == 0);
+  EXPECT(rbbCommit(rb, 1) == -1); // Nothing reserved
+  EXPECT(rbbWrite(rb, bytes, 100) == 100);
+  EXPECT(rbbWrite(rb, bytes + 100, 100) == 28);
+  EXPECT(rbbSize(rb) == 128);
+  EXPECT(rbbReserve(rb, &n) == 0);
+  EXPECT(n == 0);
+  EXPECT(rbbRead(rb, out, 60) == 60);
+  EXPECT(memcmp(out, bytes, 60) == 0);
+
+  uint8_t* dst = (uint8_t*) rbbReserve(rb, &n);
+  EXPECT((dst != 0) && (n == 60)); // Free space starts at storage beginning
+  memcpy(dst, bytes + 128, 50);
+  EXPECT(rbbCommit(rb, 61) == -1);
+  EXPECT(rbbCommit(rb, 50) == 0);
+  EXPECT(rbbSize(rb) == 118);
+
+  const uint8_t* src = (const uint8_t*) rbbPeek(rb, &n);
+  EXPECT((src != 0) && (n == 68) && (memcmp(src, bytes + 60, n) == 0));
+  EXPECT(rbbConsume(rb, 119) == -1);
+  EXPECT(rbbConsume(rb, 68) == 0);
+  EXPECT(rbbRead(rb, out, 256) == 50);
+  EXPECT(memcmp(out, bytes + 128, 50) == 0);
+  EXPECT(rbbSize(rb) == 0);
+
+  // Records
+  rbbReset(rb);
+  EXPECT(rbbRecordReserve(rb, 128) == 0); // Header does not fit
+  EXPECT(rbbRecordCommit(rb, 0) == -1);
+  EXPECT(rbbRecordPush(rb, bytes, 0) == 0);
+  EXPECT((rbbRecordPeek(rb, &n) != 0) && (n == 0));
+  EXPECT(rbbRecordConsume(rb) == 0);
+  EXPECT(rbbRecordConsume(rb) == -1);
+
+  size_t pushed = 0;
+  size_t popped = 0;
+  for (size_t i = 0; i < RTESTLEN; ++i){
+    size_t len = (i*7)%50 + 1;
+    while (rbbRecordPush(rb, bytes + i%64, len) != 0){
+      const uint8_t* rec = (const uint8_t*) rbbRecordPeek(rb, &n);
+      SEXPECT(rec != 0);
+      SEXPECT(((uintptr_t) rec)%8 == 0);
+      SEXPECT(n == (popped*7)%50 + 1);
+      SEXPECT(memcmp(rec, bytes + popped%64, n) == 0);
+      SEXPECT(rbbRecordConsume(rb) == 0);
+      ++popped;
+    }
+    ++pushed;
+  }
+  while (rbbRecordPeek(rb, &n) != 0){
+    SEXPECT(n == (popped*7)%50 + 1);
+    rbbRecordConsume(rb);
+    ++popped;
+  }
+  EXPECT(pushed == popped);
+  EXPECT(rbbSize(rb) == 0);
+
+  // Shrinking reserved record
+  uint8_t* rec = (uint8_t*) rbbRecordReserve(rb, 100);
+  EXPECT(rec != 0);
+  memcpy(rec, bytes, 10);
+  EXPECT(rbbRecordCommit(rb, 101) == -1);
+  EXPECT(rbbRecordCommit(rb, 10) == 0);
+  EXPECT((rbbRecordPeek(rb, &n) != 0) && (n == 10));
+  rbbCleanup(&rb);
+  EXPECT(rb == 0);
+
+  // Staging messages inline against malloc per message
+  const size_t total = 1 << 18;
+  struct timespec start;
+  rb = rbbInit(1 << 16);
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for (size_t i = 0; i < total; i += 256){ // Batches of messages in flight
+    for (size_t j = 0; j < 256; ++j){
+      size_t len = 16 + (i + j)%100;
+      void* msg = rbbRecordReserve(rb, len);
+      memcpy(msg, bytes, len);
+      rbbRecordCommit(rb, len);
+    }
+    for (size_t j = 0; j < 256; ++j){
+      rbbRecordPeek(rb, &n);
+      rbbRecordConsume(rb);
+    }
+  }
+  printf("RBBYTES records: %f Mmsg/sec\n", total/GetTime(&start)*1.0e-6);
+  rbbCleanup(&rb);
+
+  RBUF ptrs = rbufInit(1024);
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for (size_t i = 0; i < total; i += 256){
+    for (size_t j = 0; j < 256; ++j){
+      size_t len = 16 + (i + j)%100;
+      void* msg = malloc(len);
+      memcpy(msg, bytes, len);
+      rbufPushBack(ptrs, msg);
+    }
+    for (size_t j = 0; j < 256; ++j){
+      free(rbufPopFront(ptrs));
+    }
+  }
+  printf("RBUF with malloc: %f Mmsg/sec\n", total/GetTime(&start)*1.0e-6);
+  rbufCleanup(&ptrs);
+}
+
+void t029(){ // Mirrored byte ring buffer
+  size_t n = 0;
+  uint8_t bytes[4096];
+
+  for (int i = 0; i < 4096; ++i){
+    bytes[i] = (uint8_t) (i*31);
+  }
+
+  RBBYTES rb = rbbInitEx(100, RBB_MIRROR);
+  EXPECT(rb != 0);
+  size_t cap = rbbCap(rb);
+  EXPECT((cap >= 4096) && ((cap & (cap - 1)) == 0)); // At least page
+
+  // Stream wrapping storage end is seen in one piece
+  EXPECT(rbbWrite(rb, bytes, cap - 100) == cap - 100);
+  EXPECT(rbbConsume(rb, cap - 100) == 0);
+  uint8_t* dst = (uint8_t*) rbbReserve(rb, &n);
+  EXPECT((dst != 0) && (n == cap));
+  memcpy(dst, bytes, 1000);
+  EXPECT(rbbCommit(rb, 1000) == 0);
+  const uint8_t* src = (const uint8_t*) rbbPeek(rb, &n);
+  EXPECT((src != 0) && (n == 1000) && (memcmp(src, bytes, 1000) == 0));
+  EXPECT(rbbRead(rb, bytes, 1000) == 1000);
+
+  // Records never need padding and parser works on ring contents in place
+  static const char json[] = "{\"name\": \"ring\", \"size\": [1, 2, 3]}";
+  rbbReset(rb);
+  EXPECT(rbbRecordPush(rb, bytes, cap - 8 - 24) == 0); // Leaves 24 bytes before storage end
+  EXPECT(rbbRecordConsume(rb) == 0);
+  EXPECT(rbbRecordPush(rb, json, sizeof(json)) == 0);
+  EXPECT(rbbSize(rb) == 8 + ((sizeof(json) + 7) & ~7));
+  const char* rec = (const char*) rbbRecordPeek(rb, &n);
+  EXPECT((rec != 0) && (n == sizeof(json)));
+  J2VAL val = j2ParseBuffer(rec, 0);
+  EXPECT(val != 0);
+  EXPECT(strcmp(joGetString(val, "name", ""), "ring") == 0);
+  EXPECT(j2ValueArraySize(j2ValueObjectItem(val, "size")) == 3);
+  j2Cleanup(&val);
+  EXPECT(rbbRecordConsume(rb) == 0);
+
+  for (size_t i = 0; i < RTESTLEN; ++i){
+    size_t len = (i*13)%700 + 1;
+    while (rbbRecordPush(rb, bytes + i%100, len) != 0){
+      SEXPECT(rbbRecordPeek(rb, &n) != 0);
+      SEXPECT(rbbRecordConsume(rb) == 0);
+    }
+    SEXPECT(rbbSize(rb) <= cap);
+  }
+  rbbCleanup(&rb);
+  EXPECT(rb == 0);
+}
+
+typedef struct {
+  uint64_t stamp;
+  uint32_t sensor;
+  double value;
+} telemetry;
+
+size_t rbufDropped = 0;
+
+void RbufCountDropped(void* value){
+  ++rbufDropped;
+  ((telemetry*) value)->sensor = 0;
+}
+
+void t030(){ // In place reserve/commit and peek/release
+  EXPECT(rbufReserve(0) == 0);
+  EXPECT(rbufCommit(0) == -1);
+  EXPECT(rbufPeek(0) == 0);
+  EXPECT(rbufRelease(0) == -1);
+
+  // Pointer ring exposes pointer slots
+  RBUF rb = rbufInit(4);
+  EXPECT(rbufCommit(rb) == -1);
+  EXPECT(rbufPeek(rb) == 0);
+  EXPECT(rbufRelease(rb) == -1);
+  void** slot = (void**) rbufReserve(rb);
+  EXPECT(slot != 0);
+  *slot = (void*) 42;
+  EXPECT(rbufSize(rb) == 0); // Not visible before commit
+  EXPECT(rbufReserve(rb) == 0); // One reservation at a time
+  EXPECT(rbufPushBack(rb, (void*) 1) == 0);
+  EXPECT(rbufPushBackN(rb, (void**) &slot, 1) == 0);
+  EXPECT(rbufCommit(rb) == 0);
+  EXPECT(rbufCommit(rb) == -1);
+  EXPECT(rbufSize(rb) == 1);
+  EXPECT(*(void**) rbufPeek(rb) == (void*) 42);
+  EXPECT(rbufPopFront(rb) == (void*) 42);
+
+  // Reused pointer slot is cleaned as by rbufPushBack
+  rbufCleaned = 0;
+  rbufSetCleanupFunc(rb, RbufCountCleanup);
+  for (uintptr_t i = 1; i < 4; ++i){
+    EXPECT(rbufPushBack(rb, (void*) i) != 0);
+  }
+  slot = (void**) rbufReserve(rb); // Slot of popped 42
+  EXPECT((slot != 0) && (*slot == 0));
+  EXPECT(rbufCleaned == 1);
+  *slot = (void*) 4;
+  EXPECT(rbufCommit(rb) == 0);
+  EXPECT(rbufReserve(rb) != 0); // Full, drops 1
+  EXPECT(rbufCleaned == 2);
+  EXPECT(rbufCommit(rb) == 0);
+  EXPECT(rbufSize(rb) == 4);
+  EXPECT(rbufPopFront(rb) == (void*) 2);
+  rbufCleanup(&rb);
+
+  // Ring with own storage
+  EXPECT(rbufInitSized(0, RBUF_DEFAULT, sizeof(telemetry)) == 0);
+  rb = rbufInitSized(3, RBUF_POW2, sizeof(telemetry));
+  EXPECT(rbufCap(rb) == 4);
+  rbufSetCleanupFunc(rb, RbufCountDropped);
+
+  for (uint32_t i = 0; i < 6; ++i){
+    telemetry* msg = (telemetry*) rbufReserve(rb);
+    EXPECT(msg != 0);
+    EXPECT(((uintptr_t) msg)%8 == 0);
+    *msg = (telemetry){i, i + 100, i*0.5};
+    EXPECT(rbufCommit(rb) == 0);
+  }
+  EXPECT(rbufSize(rb) == 4);
+  EXPECT(rbufDropped == 2);
+
+  telemetry* first = (telemetry*) rbufPeek(rb);
+  EXPECT((first != 0) && (first->stamp == 2) && (first->sensor == 102));
+  EXPECT(rbufValue(rbufFront(rb)) == first);
+  EXPECT(((telemetry*) rbufValue(rbufAt(rb, 3)))->stamp == 5);
+  EXPECT(rbufRelease(rb) == 0);
+
+  telemetry copy = {77, 7, 7.0};
+  EXPECT(rbufPushBack(rb, &copy) != 0);
+  EXPECT(((telemetry*) rbufValue(rbufBack(rb)))->stamp == 77);
+  EXPECT(rbufPushBack(rb, 0) != 0); // Zeroed item, oldest dropped
+  EXPECT(((telemetry*) rbufValue(rbufBack(rb)))->stamp == 0);
+  EXPECT(rbufDropped == 3);
+
+  uint64_t stamps[4] = {4, 5, 77, 0};
+  for (int i = 0; i < 4; ++i){
+    telemetry* msg = (telemetry*) rbufPeek(rb);
+    EXPECT((msg != 0) && (msg->stamp == stamps[i]));
+    EXPECT(rbufRelease(rb) == 0);
+  }
+  EXPECT(rbufPeek(rb) == 0);
+  rbufCleanup(&rb);
+  EXPECT(rb == 0);
+
+  // In place messages against malloc per message
+  const size_t total = 1 << 20;
+  struct timespec start;
+  double sum = 0;
+  rb = rbufInitSized(1024, RBUF_POW2, sizeof(telemetry));
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for (size_t i = 0; i < total; i += 256){
+    for (size_t j = 0; j < 256; ++j){
+      telemetry* msg = (telemetry*) rbufReserve(rb);
+      msg->stamp = i + j;
+      msg->sensor = (uint32_t) j;
+      msg->value = 1.0;
+      rbufCommit(rb);
+    }
+    for (size_t j = 0; j < 256; ++j){
+      sum += ((telemetry*) rbufPeek(rb))->value;
+      rbufRelease(rb);
+    }
+  }
+  printf("RBUF in place: %f Mmsg/sec\n", total/GetTime(&start)*1.0e-6);
+  rbufCleanup(&rb);
+
+  rb = rbufInitEx(1024, RBUF_POW2);
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for (size_t i = 0; i < total; i += 256){
+    for (size_t j = 0; j < 256; ++j){
+      telemetry* msg = (telemetry*) malloc(sizeof(telemetry));
+      msg->stamp = i + j;
+      msg->sensor = (uint32_t) j;
+      msg->value = 1.0;
+      rbufPushBack(rb, msg);
+    }
+    for (size_t j = 0; j < 256; ++j){
+      telemetry* msg = (telemetry*) rbufPopFront(rb);
+      sum += msg->value;
+      free(msg);
+    }
+  }
+  printf("RBUF with malloc: %f Mmsg/sec\n", total/GetTime(&start)*1.0e-6);
+  EXPECT(sum == 2.0*total);
+  rbufCleanup(&rb);
+}
+
+typedef struct {
+  RBSPSC rb;
+  uintptr_t count;
+  useconds_t pause; // Pause before every push
+  struct timespec sent[16]; // Push times
+} rbWakeJob;
+
+void* RbspscPacedProducerThread(void* arg){
+  rbWakeJob* job = (rbWakeJob*) arg;
+  for (uintptr_t i = 0; i < job->count; ++i){
+    usleep(job->pause);
+    clock_gettime(CLOCK_MONOTONIC, job->sent + i%16);
+    rbspscPush(job->rb, (void*) (i + 1));
+  }
+  return 0;
+}
+
+void t031(){ // Blocking SPSC ring
+  void* value = 0;
+  pthread_t thread;
+  struct timespec start;
+
+  EXPECT(rbspscPopWait(0, &value, 0) == -1);
+  EXPECT(rbspscEventFd(0) == -1);
+
+  RBSPSC rb = rbspscInit(16);
+  EXPECT(rbspscPopWait(rb, &value, 10) == -1); // Polling ring can not block
+  EXPECT(rbspscEventFd(rb) == -1);
+  rbspscCleanup(&rb);
+
+  rb = rbspscInitEx(16, RBSPSC_BLOCKING);
+  EXPECT(rb != 0);
+  EXPECT(rbspscPopWait(rb, &value, 0) == -1);
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  EXPECT(rbspscPopWait(rb, &value, 20) == -1);
+  EXPECT(GetTime(&start) >= 0.019);
+  EXPECT(rbspscPush(rb, (void*) 1) == 0);
+  EXPECT((rbspscPopWait(rb, &value, -1) == 0) && (value == (void*) 1));
+
+  // Sleeping consumer uses no processor time and wakes quickly
+  rbWakeJob job = {.rb = rb, .count = 16, .pause = 5000, .sent = {{0}}};
+  double latency = 0;
+  struct timespec cpu;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &cpu);
+  EXPECT(pthread_create(&thread, 0, RbspscPacedProducerThread, &job) == 0);
+  for (uintptr_t i = 0; i < job.count; ++i){
+    SEXPECT((rbspscPopWait(rb, &value, -1) == 0) && (value == (void*) (i + 1)));
+    latency += GetTime(job.sent + i%16);
+  }
+  struct timespec cpuEnd;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &cpuEnd);
+  double busy = (cpuEnd.tv_sec - cpu.tv_sec) + (cpuEnd.tv_nsec - cpu.tv_nsec)*1.0e-9;
+  pthread_join(thread, 0);
+  EXPECT(busy < 0.04); // Consumer idled through 80 ms
+  printf("Consumer CPU %f sec in %f sec, mean wakeup latency %f usec\n",
+    busy, job.count*job.pause*1.0e-6, latency/job.count*1.0e6);
+
+  // Bulk hand-off keeps order
+  rbProducerJob bulk = {rb, 0, 0, 1 << 16};
+  EXPECT(pthread_create(&thread, 0, RbspscProducerThread, &bulk) == 0);
+  for (uintptr_t i = 1; i <= bulk.count; ++i){
+    SEXPECT((rbspscPopWait(rb, &value, -1) == 0) && (value == (void*) i));
+  }
+  pthread_join(thread, 0);
+  rbspscCleanup(&rb);
+
+  // Ring in epoll set
+  rb = rbspscInitEx(16, RBSPSC_EVENTFD);
+  EXPECT(rbspscEventFd(rb) >= 0);
+  int ep = epoll_create1(0);
+  struct epoll_event ev = {EPOLLIN, {0}};
+  struct epoll_event got;
+  EXPECT(epoll_ctl(ep, EPOLL_CTL_ADD, rbspscEventFd(rb), &ev) == 0);
+  EXPECT(epoll_wait(ep, &got, 1, 0) == 0);
+
+  job = (rbWakeJob){.rb = rb, .count = 16, .pause = 2000, .sent = {{0}}};
+  EXPECT(pthread_create(&thread, 0, RbspscPacedProducerThread, &job) == 0);
+  uintptr_t expect = 1;
+  while (expect <= job.count){
+    SEXPECT(epoll_wait(ep, &got, 1, 1000) == 1);
+    while (rbspscPop(rb, &value) == 0){
+      SEXPECT(value == (void*) expect);
+      ++expect;
+    }
+  }
+  pthread_join(thread, 0);
+  EXPECT(epoll_wait(ep, &got, 1, 0) == 0); // Drained and armed
+  EXPECT(rbspscPush(rb, (void*) 1) == 0);
+  EXPECT(epoll_wait(ep, &got, 1, 0) == 1);
+  EXPECT(rbspscPush(rb, (void*) 2) == 0);
+  EXPECT((rbspscPop(rb, &value) == 0) && (rbspscPop(rb, &value) == 0) && (value == (void*) 2));
+  EXPECT(rbspscPop(rb, &value) == -1);
+  EXPECT(epoll_wait(ep, &got, 1, 0) == 0);
+  close(ep);
+  rbspscCleanup(&rb);
+}
+
+typedef struct {
+  uint32_t producer;
+  uint32_t seq;
+  uint8_t payload[56];
+} shmRecord;
+
+/**
+ * Push records from child process and exit.
+ */
+void RbshmChild(int fd, uint32_t producer, uint32_t count){
+  RBSHM rb = rbshmOpenFd(fd);
+  shmRecord rec;
+  if (rb == 0){
+    _exit(1);
+  }
+  memset(&rec, 0, sizeof(rec));
+  rec.producer = producer;
+  for (uint32_t i = 1; i <= count; ++i){
+    rec.seq = i;
+    rec.payload[0] = (uint8_t) i;
+    while (rbshmPush(rb, &rec, sizeof(rec)) != 0){
+      sched_yield();
+    }
+  }
+  rbshmCleanup(&rb);
+  _exit(0);
+}
+
+void t032(){ // Shared memory ring between processes
+  char name[64];
+  shmRecord rec;
+  size_t size = 0;
+  uint64_t ticket = 0;
+  int status = 0;
+
+  snprintf(name, sizeof(name), "/alpha0-rbshm-%d", (int) getpid());
+
+  EXPECT(rbshmCreate(0, 0, 8) == 0);
+  EXPECT(rbshmCreate(0, 8, 0) == 0);
+  EXPECT(rbshmOpen(0) == 0);
+  EXPECT(rbshmOpenFd(-1) == 0);
+  EXPECT(rbshmFd(0) == -1);
+  EXPECT(rbshmCap(0) == 0);
+  EXPECT(rbshmSize(0) == 0);
+  EXPECT(rbshmPush(0, &rec, 1) == -1);
+  EXPECT(rbshmPop(0, &rec, &size) == -1);
+  EXPECT(rbshmReserve(0, &ticket) == 0);
+  EXPECT(rbshmPeek(0, &ticket, &size) == 0);
+  rbshmCleanup(0); // No segfault
+
+  // Named object attached twice in one process
+  rbshmUnlink(name);
+  RBSHM rb = rbshmCreate(name, 5, sizeof(shmRecord));
+  EXPECT(rb != 0);
+  EXPECT(rbshmCreate(name, 5, sizeof(shmRecord)) == 0); // Already exists
+  EXPECT((rbshmCap(rb) == 8) && (rbshmItemSize(rb) == sizeof(shmRecord)));
+  RBSHM other = rbshmOpen(name);
+  EXPECT(other != 0);
+  EXPECT(rbshmUnlink(name) == 0);
+  EXPECT(rbshmOpen(name) == 0);
+  EXPECT(rbshmCap(other) == 8);
+
+  EXPECT(rbshmPop(other, &rec, &size) == -1);
+  for (uint32_t i = 0; i < 8; ++i){
+    rec.seq = i;
+    EXPECT(rbshmPush(rb, &rec, sizeof(rec)) == 0);
+  }
+  EXPECT(rbshmPush(rb, &rec, sizeof(rec)) == -1);
+  EXPECT(rbshmPush(rb, &rec, sizeof(rec) + 1) == -1);
+  EXPECT(rbshmSize(other) == 8);
+  for (uint32_t i = 0; i < 8; ++i){
+    EXPECT((rbshmPop(other, &rec, &size) == 0) && (size == sizeof(rec)) && (rec.seq == i));
+  }
+
+  // In place access
+  shmRecord* dst = (shmRecord*) rbshmReserve(other, &ticket);
+  EXPECT((dst != 0) && (((uintptr_t) dst)%8 == 0));
+  dst->seq = 77;
+  EXPECT(rbshmPeek(rb, &ticket, &size) == 0); // Not committed yet
+  EXPECT(rbshmCommit(other, ticket, sizeof(shmRecord) + 1) == -1);
+  EXPECT(rbshmCommit(other, ticket, 4) == 0);
+  EXPECT(rbshmCommit(other, ticket, 4) == -1);
+  const shmRecord* src = (const shmRecord*) rbshmPeek(rb, &ticket, &size);
+  EXPECT((src != 0) && (size == 4) && (src->seq == 77));
+  EXPECT(rbshmRelease(rb, ticket) == 0);
+  EXPECT(rbshmRelease(rb, ticket) == -1);
+
+  // Peer rewriting sizes in shared memory can not overflow consumer
+  uint64_t* shared = (uint64_t*) mmap(0, 4*sizeof(uint64_t), PROT_READ | PROT_WRITE, MAP_SHARED, rbshmFd(rb), 0);
+  EXPECT(shared != MAP_FAILED);
+  shared[2] = 1 << 20; // Header maximum record size
+  EXPECT(rbshmItemSize(other) == sizeof(shmRecord));
+  dst = (shmRecord*) rbshmReserve(other, &ticket);
+  EXPECT(rbshmCommit(other, ticket, sizeof(shmRecord) + 1) == -1);
+  EXPECT(rbshmCommit(other, ticket, sizeof(shmRecord)) == 0);
+  ((uint64_t*) dst)[-1] = 1 << 20; // Slot record size
+  EXPECT((rbshmPop(rb, &rec, &size) == 0) && (size == sizeof(shmRecord)));
+  munmap(shared, 4*sizeof(uint64_t));
+  rbshmCleanup(&other);
+  rbshmCleanup(&rb);
+  EXPECT(rb == 0);
+
+  // Producers in child processes, consumer in parent
+  const uint32_t count = 1 << 16;
+  for (uint32_t producers = 1; producers <= 2; ++producers){
+    uint32_t last[2] = {0, 0};
+    uint32_t disorder = 0;
+    struct timespec start;
+    pid_t pids[2];
+
+    rb = rbshmCreate(0, 1024, sizeof(shmRecord));
+    EXPECT(rb != 0);
+    fflush(stdout);
+    fflush(stderr);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (uint32_t p = 0; p < producers; ++p){
+      pids[p] = fork();
+      if (pids[p] == 0){
+        RbshmChild(rbshmFd(rb), p, count);
+      }
+      EXPECT(pids[p] > 0);
+    }
+    for (uint32_t i = 0; i < producers*count; ++i){
+      while (rbshmPop(rb, &rec, &size) != 0){
+        sched_yield();
+      }
+      SEXPECT((size == sizeof(rec)) && (rec.producer < producers));
+      SEXPECT(rec.payload[0] == (uint8_t) rec.seq);
+      disorder += (rec.seq != last[rec.producer] + 1);
+      last[rec.producer] = rec.seq;
+    }
+    double elapsed = GetTime(&start);
+    for (uint32_t p = 0; p < producers; ++p){
+      EXPECT((waitpid(pids[p], &status, 0) == pids[p]) && WIFEXITED(status) && (WEXITSTATUS(status) == 0));
+      EXPECT(last[p] == count);
+    }
+    EXPECT(disorder == 0);
+    EXPECT(rbshmSize(rb) == 0);
+    printf("RBSHM %u producer processes: %f Mrec/sec\n", producers, producers*count/elapsed*1.0e-6);
+    rbshmCleanup(&rb);
+  }
+
+  // Same records through pipe
+  int fds[2];
+  EXPECT(pipe(fds) == 0);
+  struct timespec start;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  pid_t pid = fork();
+  if (pid == 0){
+    close(fds[0]);
+    memset(&rec, 0, sizeof(rec));
+    for (uint32_t i = 1; i <= count; ++i){
+      rec.seq = i;
+      if (write(fds[1], &rec, sizeof(rec)) != sizeof(rec)){
+        _exit(1);
+      }
+    }
+    _exit(0);
+  }
+  close(fds[1]);
+  uint32_t received = 0;
+  size_t got = 0;
+  for (;;){
+    ssize_t part = read(fds[0], ((uint8_t*) &rec) + got, sizeof(rec) - got);
+    if (part <= 0){
+      break;
+    }
+    got += (size_t) part;
+    if (got == sizeof(rec)){
+      SEXPECT(rec.seq == received + 1);
+      ++received;
+      got = 0;
+    }
+  }
+  close(fds[0]);
+  EXPECT((waitpid(pid, &status, 0) == pid) && WIFEXITED(status));
+  EXPECT(received == count);
+  printf("Pipe: %f Mrec/sec\n", count/GetTime(&start)*1.0e-6);
+}
+
+typedef struct {
+  RBCREADER rd;
+  RBCREADER dep; // Reader, which must be ahead
+  uintptr_t count;
+  uintptr_t producers;
+  uintptr_t sum;
+  uintptr_t errors;
+} rbCastJob;
+
+void* RbcastReaderThread(void* arg){
+  rbCastJob* job = (rbCastJob*) arg;
+  uintptr_t last[MPMC_MAX_THREADS] = {0};
+  void* batch[32];
+  uintptr_t done = 0;
+  while (done < job->count){
+    uint64_t first = rbcastCursor(job->rd);
+    size_t got = rbcastPoll(job->rd, batch, 32);
+    if (got == 0){
+      sched_yield();
+      continue;
+    }
+    if ((job->dep != 0) && (rbcastCursor(job->dep) < first + got)){
+      ++job->errors;
+    }
+    for (size_t i = 0; i < got; ++i){
+      uintptr_t producer = ((uintptr_t) batch[i]) >> 32;
+      uintptr_t seq = ((uintptr_t) batch[i]) & 0xFFFFFFFF;
+      job->errors += (producer >= job->producers) || (seq != last[producer] + 1);
+      last[producer] = seq;
+      job->sum += seq;
+    }
+    done += got;
+  }
+  return 0;
+}
+
+typedef struct {
+  RBCAST rb;
+  uintptr_t id;
+  uintptr_t count;
+} rbCastProducerJob;
+
+void* RbcastProducerThread(void* arg){
+  rbCastProducerJob* job = (rbCastProducerJob*) arg;
+  for (uintptr_t i = 1; i <= job->count; ++i){
+    rbcastPush(job->rb, (void*) ((job->id << 32) | i));
+  }
+  return 0;
+}
+
+void t033(){ // Broadcast ring
+  void* value = 0;
+  void* batch[8];
+  uint64_t seq = 0;
+
+  EXPECT(rbcastInit(0) == 0);
+  EXPECT(rbcastCap(0) == 0);
+  EXPECT(rbcastAttach(0, 0, 0) == 0);
+  EXPECT(rbcastTryClaim(0, &seq) == -1);
+  EXPECT(rbcastPublish(0, 0, 0) == -1);
+  EXPECT(rbcastTryPush(0, 0) == -1);
+  EXPECT(rbcastPoll(0, batch, 8) == 0);
+  EXPECT(rbcastRead(0, &value) == -1);
+  rbcastCleanup(0); // No segfault
+
+  RBCAST rb = rbcastInit(3);
+  EXPECT(rbcastCap(rb) == 4);
+  RBCREADER a = rbcastAttach(rb, 0, 0);
+  RBCREADER b = rbcastAttach(rb, 0, 0);
+  RBCREADER c = rbcastAttach(rb, &a, 1); // Sees only what a has read
+  EXPECT((a != 0) && (b != 0) && (c != 0));
+  EXPECT(rbcastAttach(rb, 0, 1) == 0);
+
+  EXPECT(rbcastPoll(a, batch, 8) == 0);
+  for (uintptr_t i = 1; i <= 4; ++i){
+    EXPECT(rbcastTryPush(rb, (void*) i) == 0);
+  }
+  EXPECT(rbcastTryPush(rb, (void*) 5) == -1); // Nobody read first item yet
+  EXPECT(rbcastPoll(c, batch, 8) == 0); // a is behind
+
+  EXPECT(rbcastPoll(a, batch, 2) == 2);
+  EXPECT((batch[0] == (void*) 1) && (batch[1] == (void*) 2));
+  EXPECT(rbcastCursor(a) == 2);
+  EXPECT(rbcastTryPush(rb, (void*) 5) == -1); // b and c gate
+  EXPECT(rbcastPoll(c, batch, 8) == 2);
+  EXPECT((batch[0] == (void*) 1) && (batch[1] == (void*) 2));
+  EXPECT(rbcastPoll(b, batch, 1) == 1);
+  EXPECT(batch[0] == (void*) 1);
+  EXPECT(rbcastTryPush(rb, (void*) 5) == 0); // Every reader passed item 1
+  EXPECT(rbcastTryPush(rb, (void*) 6) == -1);
+
+  // Claimed but not published item stops readers
+  EXPECT(rbcastPoll(b, batch, 8) == 4);
+  EXPECT(rbcastPoll(a, batch, 8) == 3);
+  EXPECT(rbcastPoll(c, batch, 8) == 3);
+  EXPECT(rbcastTryClaim(rb, &seq) == 0);
+  EXPECT(seq == 5);
+  EXPECT(rbcastPoll(a, batch, 8) == 0);
+  EXPECT(rbcastPublish(rb, seq, (void*) 6) == 0);
+  EXPECT(rbcastPublish(rb, seq + 1, (void*) 7) == -1); // Not claimed
+  EXPECT(rbcastPublish(rb, seq, (void*) 7) == -1); // Already published
+  EXPECT(rbcastPublish(rb, seq - rbcastCap(rb), (void*) 7) == -1); // Slot reused
+  EXPECT((rbcastRead(a, &value) == 0) && (value == (void*) 6));
+  EXPECT((rbcastRead(b, &value) == 0) && (value == (void*) 6));
+  EXPECT((rbcastRead(c, &value) == 0) && (value == (void*) 6));
+  RBCAST foreign = rbcastInit(4);
+  EXPECT(rbcastAttach(foreign, &a, 1) == 0); // Dependency from other ring
+  rbcastCleanup(&foreign);
+  rbcastCleanup(&rb);
+  EXPECT(rb == 0);
+
+  // Whole ring claimed before anything is published
+  rb = rbcastInit(4);
+  a = rbcastAttach(rb, 0, 0);
+  uint64_t claimed[4];
+  for (int i = 0; i < 4; ++i){
+    EXPECT(rbcastTryClaim(rb, claimed + i) == 0);
+  }
+  EXPECT(rbcastTryClaim(rb, &seq) == -1);
+  for (int i = 0; i < 4; ++i){
+    EXPECT(rbcastPublish(rb, claimed[i], (void*) (uintptr_t) (i + 1)) == 0);
+  }
+  EXPECT(rbcastPoll(a, batch, 8) == 4);
+  EXPECT((batch[0] == (void*) 1) && (batch[3] == (void*) 4));
+  EXPECT(rbcastPublish(rb, claimed[0], (void*) 9) == -1); // Already published
+  EXPECT(rbcastTryClaim(rb, &seq) == 0);
+  EXPECT(rbcastPublish(rb, seq, (void*) 5) == 0);
+  EXPECT(rbcastPublish(rb, claimed[0], (void*) 9) == -1); // Slot reused
+  EXPECT((rbcastRead(a, &value) == 0) && (value == (void*) 5));
+  rbcastCleanup(&rb);
+
+  // Persistence and metrics see everything, forwarding follows persistence
+  const uintptr_t total = 1 << 18;
+  for (uintptr_t producers = 1; producers <= 2; ++producers){
+    pthread_t readers[3];
+    pthread_t writers[2];
+    rbCastProducerJob pjobs[2];
+    rbCastJob jobs[3];
+    struct timespec start;
+
+    rb = rbcastInit(1024);
+    RBCREADER persist = rbcastAttach(rb, 0, 0);
+    RBCREADER metrics = rbcastAttach(rb, 0, 0);
+    RBCREADER forward = rbcastAttach(rb, &persist, 1);
+    jobs[0] = (rbCastJob){persist, 0, total, producers, 0, 0};
+    jobs[1] = (rbCastJob){metrics, 0, total, producers, 0, 0};
+    jobs[2] = (rbCastJob){forward, persist, total, producers, 0, 0};
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < 3; ++i){
+      EXPECT(pthread_create(readers + i, 0, RbcastReaderThread, jobs + i) == 0);
+    }
+    for (uintptr_t i = 0; i < producers; ++i){
+      pjobs[i] = (rbCastProducerJob){rb, i, total/producers};
+      EXPECT(pthread_create(writers + i, 0, RbcastProducerThread, pjobs + i) == 0);
+    }
+    for (uintptr_t i = 0; i < producers; ++i){
+      pthread_join(writers[i], 0);
+    }
+    for (int i = 0; i < 3; ++i){
+      pthread_join(readers[i], 0);
+      EXPECT(jobs[i].errors == 0);
+      EXPECT(jobs[i].sum == producers*((total/producers)*(total/producers + 1)/2));
+    }
+    printf("%"PRIuPTR" producers, 3 readers: %f Mevents/sec\n", producers, total/GetTime(&start)*1.0e-6);
+    rbcastCleanup(&rb);
+  }
+}
+
 void t007(){
   RBUF rb = rbufInit(5);
 
@@ -356,6 +2495,11 @@ void t008(){
 
   EXPECT(rbufPopFront(rb) == 0);
 
+  // Push after buffer drained
+  rbufPushBack(rb, (void*) value[0]);
+  EXPECT(rbufFront(rb) == rbufBack(rb));
+  EXPECT(rbufPopFront(rb) == (void*) value[0]);
+
   rbufCleanup(&rb);
 }
 
@@ -430,6 +2574,30 @@ int main(int argc, char* argv[]){
   RUN(t007);
   RUN(t008);
   RUN(t009);
+  RUN(t010);
+  RUN(t011);
+  RUN(t012);
+  RUN(t013);
+  RUN(t014);
+  RUN(t015);
+  RUN(t016);
+  RUN(t017);
+  RUN(t018);
+  RUN(t019);
+  RUN(t020);
+  RUN(t021);
+  RUN(t022);
+  RUN(t023);
+  RUN(t024);
+  RUN(t025);
+  RUN(t026);
+  RUN(t027);
+  RUN(t028);
+  RUN(t029);
+  RUN(t030);
+  RUN(t031);
+  RUN(t032);
+  RUN(t033);
 
   // Need check for udLeft with UDITEM from different hash
   return 0;